@@ -149,3 +149,280 @@ bool b58enc(char *b58, const void *data, size_t binsz)
 	
 	return 1;
 }
+
+// Largest payload of the fixed-size encoders (a compressed WIF key), the
+// 32-bit limbs it takes, and room for its digits in whole passes of five.
+#define B58_MAX_BIN     38
+#define B58_MAX_LIMBS   ((B58_MAX_BIN + 3) / 4)
+#define B58_MAX_DIGITS  ((B58_MAX_BIN * 138 / 100 + 5) / 5 * 5 + 5)
+
+// Address payloads are encoded this many at a time by b58enc_addr_many().
+#define B58_LANES  4
+
+// Load the 25-byte address payload 'bin' into 7 big-endian 32-bit limbs.
+static inline void b58load_addr(uint32_t limb[7], const uint8_t *bin)
+{
+	int i;
+	
+	limb[0] = bin[0];
+	for (i = 1; i < 7; ++i)
+		limb[i] = ((uint32_t)bin[i * 4 - 3] << 24) | (bin[i * 4 - 2] << 16) |
+		          (bin[i * 4 - 1] << 8) | bin[i * 4];
+}
+
+// Write the digits buf[j..size-1] of a payload 'bin' of 'binsz' bytes as a
+// string, after skipping their leading zeros and putting back a '1' for each
+// leading zero byte. Returns the length of the string.
+static inline size_t b58emit(char *b58, const uint8_t *bin, size_t binsz,
+                             const uint8_t *buf, size_t j, size_t size)
+{
+	size_t i, zcount;
+	
+	for (zcount = 0; zcount < binsz && !bin[zcount]; ++zcount);
+	while (j < size && !buf[j])
+		++j;
+	
+	memset(b58, '1', zcount);
+	for (i = zcount; j < size; ++i, ++j)
+		b58[i] = b58digits_ordered[buf[j]];
+	b58[i] = '\0';
+	
+	return i;
+}
+
+// Fixed-size Base58 encoder. The input is loaded into 32-bit limbs and
+// repeatedly divided by 58^5, so each pass over the limbs yields five digits
+// and the divisions by a constant compile to 64-bit multiplies. Returns the
+// length of the encoded string.
+static inline __attribute__((always_inline))
+size_t b58enc_fixed(char *b58, const uint8_t *bin, const size_t binsz)
+{
+	const size_t nlimbs = (binsz + 3) / 4, pad = nlimbs * 4 - binsz;
+	uint32_t limb[B58_MAX_LIMBS], chunk;
+	uint8_t buf[B58_MAX_DIGITS];
+	uint64_t rem;
+	size_t i, j, start;
+	
+	// Load big-endian input, most significant limb first
+	memset(limb, 0, nlimbs * sizeof(*limb));
+	for (i = 0; i < binsz; ++i)
+		limb[(i + pad) / 4] |= (uint32_t)bin[i] << (8 * (3 - (i + pad) % 4));
+	
+	for (start = 0; start < nlimbs && !limb[start]; ++start);
+	
+	for (j = sizeof(buf); start < nlimbs; )
+	{
+		rem = 0;
+		for (i = start; i < nlimbs; ++i)
+		{
+			rem = (rem << 32) | limb[i];
+			limb[i] = rem / 656356768;  // 58^5
+			rem -= (uint64_t)limb[i] * 656356768;
+		}
+		if (!limb[start])
+			++start;
+		
+		for (chunk = rem, i = 0; i < 5; ++i)
+		{
+			buf[--j] = chunk % 58;
+			chunk /= 58;
+		}
+	}
+	
+	return b58emit(b58, bin, binsz, buf, j, sizeof(buf));
+}
+
+// Encode a 25-byte address payload (version, hash160, checksum).
+size_t b58enc_addr(char *b58, const void *data)
+{
+	return b58enc_fixed(b58, data, 25);
+}
+
+// Encode a 38-byte compressed WIF payload (0x80, key, 0x01, checksum).
+size_t b58enc_wif(char *b58, const void *data)
+{
+	return b58enc_fixed(b58, data, 38);
+}
+
+// Encode 'n' 25-byte address payloads stored back-to-back in 'data'. Each
+// string is written 'stride' bytes (at least 36) after the previous one.
+// Payloads are divided by 58^5 B58_LANES at a time, limb by limb, so the
+// dependent multiply chains of the lanes overlap instead of running one
+// after the other; seven passes give the 35 digits any payload fits in.
+void b58enc_addr_many(char *b58, size_t stride, const void *data, size_t n)
+{
+	const uint8_t *bin = data;
+	uint32_t limb[B58_LANES][7], chunk;
+	uint8_t buf[B58_LANES][35];
+	uint64_t rem[B58_LANES];
+	size_t i, j, k, start;
+	
+	for (; n >= B58_LANES; n -= B58_LANES)
+	{
+		for (k = 0; k < B58_LANES; ++k)
+			b58load_addr(limb[k], bin + k * 25);
+		
+		for (start = 0, j = 35; j; j -= 5)
+		{
+			for (k = 0; k < B58_LANES; ++k)
+				rem[k] = 0;
+			for (i = start; i < 7; ++i)
+				for (k = 0; k < B58_LANES; ++k)
+				{
+					rem[k] = (rem[k] << 32) | limb[k][i];
+					limb[k][i] = rem[k] / 656356768;  // 58^5
+					rem[k] -= (uint64_t)limb[k][i] * 656356768;
+				}
+			
+			// Skip the limbs that are zero in every lane
+			for (; start < 7; ++start)
+			{
+				for (chunk = 0, k = 0; k < B58_LANES; ++k)
+					chunk |= limb[k][start];
+				if (chunk)
+					break;
+			}
+			
+			for (k = 0; k < B58_LANES; ++k)
+				for (chunk = rem[k], i = 1; i <= 5; ++i)
+				{
+					buf[k][j - i] = chunk % 58;
+					chunk /= 58;
+				}
+		}
+		
+		for (k = 0; k < B58_LANES; ++k, bin += 25, b58 += stride)
+			b58emit(b58, bin, 25, buf[k], 0, 35);
+	}
+	
+	for (; n; --n, bin += 25, b58 += stride)
+		b58enc_fixed(b58, bin, 25);
+}
+
+// Return the last ten Base58 digits of a 25-byte address payload as a number,
+// i.e. the payload modulo 58^10. This is two fixed-width passes of the same
+// division by 58^5 used by b58enc_fixed(), without producing the digits.
+uint64_t b58tail_addr(const void *data)
+{
+	uint32_t limb[7];
+	uint64_t rem = 0, low = 0;
+	int i, pass;
+	
+	b58load_addr(limb, data);
+	
+	for (pass = 0; pass < 2; ++pass)
+	{
+		low = rem;
+		rem = 0;
+		for (i = 0; i < 7; ++i)
+		{
+			rem = (rem << 32) | limb[i];
+			limb[i] = rem / 656356768;  // 58^5
+			rem -= (uint64_t)limb[i] * 656356768;
+		}
+	}
+	
+	return rem * 656356768 + low;
+}
+
+// Leading digits of address payloads, for case-insensitive prefix matching.
+// A payload of 'nb' bits is t*2^s plus less than 2^s, where t is its top 64
+// bits and s=nb-64, so floor(payload/58^e) is found by a single high multiply
+// of t with a 63-bit reciprocal of 58^e, instead of passes over all limbs.
+// Picking e from the number of digits of 2^(nb-1) leaves the leading 8 or 9
+// digits. The reciprocals are floor(2^256/58^e), made by dividing 2^256 by
+// 58 over and over, and truncated, so t*q never overestimates.
+static struct {
+	uint64_t q;  // Top 63 bits of 2^256/58^e
+	int shift;   // Bits to drop from the high half of t*q
+} head_div[201];
+
+static bool head_ready;
+
+static void b58head_init(void)
+{
+	uint32_t limb[9] = {1};  // 2^256, most significant limb first
+	uint64_t q[27], rem;
+	int drop[27], e, i, j, nb, bits, pos, digits;
+	
+	for (e = 0; e < 27; ++e)
+	{
+		for (i = 0; !limb[i]; ++i);
+		bits = (8 - i) * 32 + 32 - __builtin_clz(limb[i]);
+		for (q[e] = 0, j = 0; j < 63; ++j)
+		{
+			pos = bits - 1 - j;
+			q[e] = (q[e] << 1) | ((limb[8 - pos / 32] >> (pos % 32)) & 1);
+		}
+		drop[e] = bits - 63;
+		
+		for (rem = 0, i = 0; i < 9; ++i)
+		{
+			rem = (rem << 32) | limb[i];
+			limb[i] = rem / 58;
+			rem %= 58;
+		}
+	}
+	
+	for (nb = 65; nb <= 200; ++nb)
+	{
+		digits = (int)((nb - 1) * log(2) / log(58)) + 1;
+		e = digits - B58_HEAD_DIGITS;
+		head_div[nb].q = q[e];
+		head_div[nb].shift = 256 - drop[e] - (nb - 64) - 64;
+	}
+	
+	head_ready = 1;
+}
+
+static inline uint64_t mulhi64(uint64_t a, uint64_t b)
+{
+#ifdef __SIZEOF_INT128__
+	return (unsigned __int128)a * b >> 64;
+#else
+	uint64_t lo = (a & 0xffffffff) * (b & 0xffffffff);
+	uint64_t m1 = (a >> 32) * (b & 0xffffffff) + (lo >> 32);
+	uint64_t m2 = (a & 0xffffffff) * (b >> 32) + (m1 & 0xffffffff);
+	
+	return (a >> 32) * (b >> 32) + (m1 >> 32) + (m2 >> 32);
+#endif
+}
+
+// Find the first B58_HEAD_DIGITS digits of the Base58 encoding of a 25-byte
+// address payload whose checksum is not known, only the version and hash in
+// its first 21 bytes, after the leading zero bytes that encode as '1's. The
+// digits are stored to 'heads' as numbers: one, or two on the rare payloads
+// where the unknown low bits could carry into them. Returns how many, and the
+// number of leading zero bytes to 'ones'. Payloads with more than 12 leading
+// zero bytes are left out.
+int b58head_addr(u64 heads[2], int *ones, const void *data)
+{
+	const uint8_t *bin = data;
+	const uint64_t top = 128063081718016;  // 58^8
+	uint64_t t = 0, lo, hi;
+	int i, z, c, nb;
+	
+	if (!head_ready)
+		b58head_init();
+	
+	for (z = 0; z < 13 && !bin[z]; ++z);
+	if (z > 12)
+		return 0;
+	
+	// Top 64 significant bits
+	c = __builtin_clz(bin[z]) - 24;
+	nb = (25 - z) * 8 - c;
+	for (i = 0; i < 8; ++i)
+		t = (t << 8) | bin[z + i];
+	t = (t << c) | (bin[z + 8] >> (8 - c));
+	
+	// Bounds on the leading digits, which drop one digit past 58^8
+	lo = mulhi64(t, head_div[nb].q);
+	hi = (lo + 2) >> head_div[nb].shift;
+	lo >>= head_div[nb].shift;
+	heads[0] = (lo >= top) ? lo / 58 : lo;
+	heads[1] = (hi >= top) ? hi / 58 : hi;
+	
+	*ones = z;
+	return 1 + (heads[1] != heads[0]);
+}
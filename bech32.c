@@ -0,0 +1,139 @@
+/* bech32.c - Bech32, bech32m (BIP 173, BIP 350) and CashAddr encoding */
+
+#include "externs.h"
+
+const char bech32_charset[]="qpzry9x8gf2tvdw0s3jn54khce6mua7l";
+
+/* Checksum constants for bech32 (witness version 0) and bech32m */
+#define BECH32_CONST  1
+#define BECH32M_CONST 0x2bc830a3
+
+
+static u32 polymod_step(u32 chk, int value)
+{
+  u32 top=chk >> 25;
+
+  chk=(chk & 0x1ffffff) << 5 ^ value;
+  if(top & 1)  chk ^= 0x3b6a57b2;
+  if(top & 2)  chk ^= 0x26508e6d;
+  if(top & 4)  chk ^= 0x1ea119fa;
+  if(top & 8)  chk ^= 0x3d4233dd;
+  if(top & 16) chk ^= 0x2a1462b3;
+
+  return chk;
+}
+
+/* CashAddr uses the same charset with a 40-bit BCH checksum */
+static u64 polymod40_step(u64 chk, int value)
+{
+  u64 top=chk >> 35;
+
+  chk=(chk & 0x7ffffffff) << 5 ^ value;
+  if(top & 1)  chk ^= 0x98f2bc8e61;
+  if(top & 2)  chk ^= 0x79b76d99e2;
+  if(top & 4)  chk ^= 0xf33e5fb3c4;
+  if(top & 8)  chk ^= 0xae2eabe2a8;
+  if(top & 16) chk ^= 0x1e4f43e470;
+
+  return chk;
+}
+
+// Return the 5-bit value of bech32 character 'c' (either case), or -1 if it
+// is not in the charset.
+//
+int bech32_value(int c)
+{
+  const char *p;
+
+  if(c >= 'A' && c <= 'Z')
+    c |= 32;
+  if(!c || !(p=strchr(bech32_charset, c)))
+    return -1;
+
+  return p-bech32_charset;
+}
+
+// Encode a segwit address with human-readable part 'hrp', witness 'version'
+// and 'len'-byte program 'prog' into 'output' (at least 91 bytes). Version 0
+// uses the bech32 checksum, later versions use bech32m.
+//
+void segwit_encode(char *output, const char *hrp, int version, const u8 *prog,
+                   int len)
+{
+  u8 data[65];
+  u32 chk=1, acc=0;
+  int i, n=0, bits=0;
+
+  /* Witness version, then the program regrouped into 5-bit values */
+  data[n++]=version;
+  for(i=0;i < len;i++) {
+    acc=acc << 8 | prog[i];
+    for(bits += 8;bits >= 5;bits -= 5)
+      data[n++]=(acc >> (bits-5)) & 31;
+  }
+  if(bits)
+    data[n++]=(acc << (5-bits)) & 31;
+
+  /* Checksum over the expanded hrp, the data and six zeros */
+  for(i=0;hrp[i];i++)
+    chk=polymod_step(chk, hrp[i] >> 5);
+  chk=polymod_step(chk, 0);
+  for(i=0;hrp[i];i++)
+    chk=polymod_step(chk, hrp[i] & 31);
+  for(i=0;i < n;i++)
+    chk=polymod_step(chk, data[i]);
+  for(i=0;i < 6;i++)
+    chk=polymod_step(chk, 0);
+  chk ^= version ? BECH32M_CONST : BECH32_CONST;
+
+  for(i=0;i < 6;i++)
+    data[n++]=(chk >> (5*(5-i))) & 31;
+
+  output += sprintf(output, "%s1", hrp);
+  for(i=0;i < n;i++)
+    *output++=bech32_charset[data[i]];
+  *output='\0';
+}
+
+// Encode a CashAddr address with prefix 'prefix' (e.g. "bitcoincash"),
+// 'version' byte (0 for P2PKH) and 'len'-byte hash 'hash' into 'output' (at
+// least 112 bytes).
+//
+void cashaddr_encode(char *output, const char *prefix, int version,
+                     const u8 *hash, int len)
+{
+  u8 data[112];
+  u64 chk=1;
+  u32 acc=version;
+  int i, n=0, bits=8;
+
+  /* Version byte, then the hash regrouped into 5-bit values */
+  for(i=0;i <= len;i++) {
+    if(i) {
+      acc=acc << 8 | hash[i-1];
+      bits += 8;
+    }
+    for(;bits >= 5;bits -= 5)
+      data[n++]=(acc >> (bits-5)) & 31;
+  }
+  if(bits)
+    data[n++]=(acc << (5-bits)) & 31;
+
+  /* Checksum over the prefix, a zero separator, the data and eight zeros */
+  for(i=0;prefix[i];i++)
+    chk=polymod40_step(chk, prefix[i] & 31);
+  chk=polymod40_step(chk, 0);
+  for(i=0;i < n;i++)
+    chk=polymod40_step(chk, data[i]);
+  for(i=0;i < 8;i++)
+    chk=polymod40_step(chk, 0);
+  chk ^= 1;
+
+  for(i=0;i < 8;i++)
+    data[n++]=(chk >> (5*(7-i))) & 31;
+
+  output += sprintf(output, "%s:", prefix);
+  for(i=0;i < n;i++)
+    *output++=bech32_charset[data[i]];
+  *output='\0';
+}
@@ -60,3 +60,49 @@ void set_working_cpu(int thread)
       i=0;  /* Wrap around */
   }
 }
+
+#define cpuid(level, arg, a, b, c, d) \
+  asm("cpuid" \
+      : "=a" (a), "=b" (b), "=c" (c), "=d" (d) \
+      : "0" (level), "2" (arg))
+
+// Return the set of CPU_* instruction set extensions usable by this process.
+// If 'signature' is non-NULL, it receives the CPU family/model/stepping word.
+//
+u32 get_cpu_features(u32 *signature)
+{
+  u32 features=0;
+
+#ifdef __x86_64__
+  u32 eax, ebx, ecx, edx, max_level, xcr0=0;
+
+  cpuid(0, 0, max_level, ebx, ecx, edx);
+  cpuid(1, 0, eax, ebx, ecx, edx);
+  if(signature)
+    *signature=eax;
+
+  if(ecx & (1 << 9))
+    features |= CPU_SSSE3;
+
+  /* AVX state must also be enabled by the OS (OSXSAVE + XCR0) */
+  if(ecx & (1 << 27))
+    asm("xgetbv" : "=a" (xcr0) : "c" (0) : "edx");
+  if((ecx & (1 << 28)) && (xcr0 & 6) == 6)
+    features |= CPU_AVX;
+
+  if(max_level >= 7) {
+    cpuid(7, 0, eax, ebx, ecx, edx);
+    if(ebx & (1 << 29))
+      features |= CPU_SHA;
+    if((features & CPU_AVX) && (ebx & (1 << 8)) && (ebx & (1 << 5)))
+      features |= CPU_AVX2;
+    if((features & CPU_AVX) && (ebx & (1 << 16)) && (xcr0 & 0xe0) == 0xe0)
+      features |= CPU_AVX512;
+  }
+#else
+  if(signature)
+    *signature=0;
+#endif
+
+  return features;
+}
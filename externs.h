@@ -9,12 +9,20 @@
 #include <math.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <limits.h>
 #include <sched.h>
+#include <time.h>
 #include <sys/signal.h>
 #include <sys/prctl.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
 #include <sys/sysinfo.h>
+#include <sys/un.h>
+#include <sys/wait.h>
 #include <arpa/inet.h>
+#include <netdb.h>
+#include <linux/futex.h>
 
 /* Define our own set of types */
 #undef quad
@@ -34,6 +42,7 @@ typedef unsigned quad u64;
 #define align4 __attribute__((aligned(4)))
 #define align8 __attribute__((aligned(8)))
 #define align16 __attribute__((aligned(16)))
+#define align64 __attribute__((aligned(64)))
 
 /* Path prediction */
 #define likely(x)   __builtin_expect((x), 1)
@@ -86,16 +95,76 @@ typedef unsigned quad u64;
 /* base58.c */
 extern bool b58tobin(void *bin, size_t *binszp, const char *b58, size_t b58sz);
 extern bool b58enc(char *b58, const void *data, size_t binsz);
+extern size_t b58enc_addr(char *b58, const void *data);
+extern size_t b58enc_wif(char *b58, const void *data);
+extern void b58enc_addr_many(char *b58, size_t stride, const void *data,
+                             size_t n);
+extern uint64_t b58tail_addr(const void *data);
+extern int b58head_addr(u64 heads[2], int *ones, const void *data);
+
+/* Leading digits found by b58head_addr() */
+#define B58_HEAD_DIGITS 8
+
+/* bech32.c */
+extern const char bech32_charset[];
+
+extern int  bech32_value(int c);
+extern void segwit_encode(char *output, const char *hrp, int version,
+                          const u8 *prog, int len);
+extern void cashaddr_encode(char *output, const char *prefix, int version,
+                            const u8 *hash, int len);
 
 /* cpu.c */
+#define CPU_SSSE3   0x01
+#define CPU_AVX     0x02
+#define CPU_AVX2    0x04  /* Includes BMI2 */
+#define CPU_SHA     0x08
+#define CPU_AVX512  0x10
+
 extern int  get_num_cpus(void);
 extern void set_working_cpu(int thread);
+extern u32  get_cpu_features(u32 *signature);
+
+/* Description of one SHA-256 or RIPEMD-160 kernel implementation */
+struct hash_kernel {
+  const char *name;  // Short name, as shown with -v and stored in the cache
+  int lanes;         // Number of blocks hashed in parallel
+  u32 cpu_flags;     // Required CPU_* features
+};
+
+/* Constant part of a 2-of-3 multisig redeem script, for hashing */
+struct multisig {
+  u32 midstate[8];  // SHA-256 state after the first 64 script bytes
+  u8 tail[5];       // Last 5 bytes of the second cosigner key
+};
+
+/* hash160.c */
+extern void hash160_many(u8 *output, const u8 *input, int n);
+extern void hash160_p2wpkh_many(u8 *output, const u8 *input, int n);
+extern void multisig_prepare(struct multisig *ms, const u8 keys[2][33]);
+extern void hash160_multisig_many(u8 *output, const u8 *input, int n,
+                                  const struct multisig *ms);
+extern void taptweak_many(u8 *output, const u8 *input, int n);
+extern void checksum_many(u8 *data, int len, int stride, int n);
+extern void hash160_register(bool verbose, bool rebench);
+
+/* keccak.c */
+extern const struct hash_kernel keccak_kernels[];
+
+extern void keccak256(char *output, const char *input, int len);
+extern void keccak256_blocks(char *output, const char *input, int n);
+extern void keccak_use_kernel(int k);
+extern void eth_encode(char *output, const u8 addr[20]);
 
 /* rmd160.c */
-extern void rmd160_init(void);
-extern void rmd160_process(const char input_block[64]);
-extern void rmd160_finish(char output[20]);
+extern const struct hash_kernel rmd160_kernels[];
+
+extern void rmd160_init(u32 state[5]);
+extern void rmd160_process(u32 state[5], const char input_block[64]);
+extern void rmd160_finish(const u32 state[5], char output[20]);
 extern void rmd160_hash(char output[20], const char input[64]);
+extern void rmd160_blocks(char *output, const char *input, int n);
+extern void rmd160_use_kernel(int k);
 
 #define rmd160_prepare(block, sz) ({ \
   int _sz=(sz); \
@@ -106,11 +175,15 @@ extern void rmd160_hash(char output[20], const char input[64]);
 })
 
 /* sha256.c */
-extern void sha256_init(void);
-extern void sha256_process(const char input_block[64]);
-extern void sha256_finish(char output[32]);
+extern const struct hash_kernel sha256_kernels[];
+
+extern void sha256_init(u32 state[8]);
+extern void sha256_process(u32 state[8], const char input_block[64]);
+extern void sha256_finish(const u32 state[8], char output[32]);
 extern void sha256_hash(char output[32], const char input[64]);
-extern void sha256_register(bool verbose);
+extern void sha256_blocks(char *output, const char *input, int n,
+                          const u32 state[8]);
+extern void sha256_use_kernel(int k);
 
 #define sha256_prepare(block, sz) ({ \
   int _sz=(sz); \
@@ -0,0 +1,438 @@
+/* hash160.c - Batched HASH160 and hash kernel selection */
+
+#include "externs.h"
+
+#include <time.h>
+
+/* Number of public keys hashed per internal batch */
+#define CHUNK 256
+
+/* Number of blocks hashed per kernel benchmark run */
+#define BENCH_BLOCKS 2048
+
+/* Name of the kernel selection cache, relative to $HOME */
+#define CACHE_FILE ".vanitygen"
+
+
+// Compute RIPEMD-160(SHA-256(x)) of 'n' 33-byte compressed public keys stored
+// back-to-back in 'input', storing n 20-byte hashes back-to-back in 'output'.
+// All intermediate state lives on the stack, so this function is reentrant.
+//
+void hash160_many(u8 *output, const u8 *input, int n)
+{
+  align16 u8 sha_block[CHUNK*64], rmd_block[CHUNK*64], digest[CHUNK*32];
+  align8 u8 sha_pad[64], rmd_pad[64];
+  int i, j, count;
+
+  /* Set up padding for input lengths of 33 (sha256) and 32 (rmd160) bytes */
+  sha256_prepare(sha_pad, 33);
+  rmd160_prepare(rmd_pad, 32);
+
+  for(i=0;i < n;i += CHUNK) {
+    count=min(n-i, CHUNK);
+
+    for(j=0;j < count;j++) {
+      memcpy(sha_block+j*64, input+(i+j)*33, 33);
+      memcpy(sha_block+j*64+33, sha_pad+33, 31);
+    }
+    sha256_blocks(digest, sha_block, count, NULL);
+
+    for(j=0;j < count;j++) {
+      memcpy(rmd_block+j*64, digest+j*32, 32);
+      memcpy(rmd_block+j*64+32, rmd_pad+32, 32);
+    }
+    rmd160_blocks(output+i*20, rmd_block, count);
+  }
+}
+
+
+// Compute the P2SH-P2WPKH script hash RIPEMD-160(SHA-256(0x00 0x14 || h)) of
+// 'n' 20-byte hashes stored back-to-back in 'input', storing n 20-byte hashes
+// in 'output'. The redeem script is always 22 bytes, so both stages are one
+// padded block per message in which only the hash changes; the constant
+// bytes are filled in once per call.
+//
+void hash160_p2wpkh_many(u8 *output, const u8 *input, int n)
+{
+  align16 u8 sha_block[CHUNK*64], rmd_block[CHUNK*64], digest[CHUNK*32];
+  int i, j, count;
+
+  sha256_prepare(sha_block, 22);
+  sha_block[1]=0x14;
+  rmd160_prepare(rmd_block, 32);
+  for(j=1;j < min(n, CHUNK);j++) {
+    memcpy(sha_block+j*64, sha_block, 64);
+    memcpy(rmd_block+j*64, rmd_block, 64);
+  }
+
+  for(i=0;i < n;i += CHUNK) {
+    count=min(n-i, CHUNK);
+
+    for(j=0;j < count;j++)
+      memcpy(sha_block+j*64+2, input+(i+j)*20, 20);
+    sha256_blocks(digest, sha_block, count, NULL);
+
+    for(j=0;j < count;j++)
+      memcpy(rmd_block+j*64, digest+j*32, 32);
+    rmd160_blocks(output+i*20, rmd_block, count);
+  }
+}
+
+
+// Prepare 'ms' for hashing 2-of-3 multisig redeem scripts
+//
+//   OP_2 <keys[0]> <keys[1]> <pubkey> OP_3 OP_CHECKMULTISIG
+//
+// where only 'pubkey' changes. The script is 105 bytes long and its first 64
+// bytes are constant, so their SHA-256 state is computed here, once.
+//
+void multisig_prepare(struct multisig *ms, const u8 keys[2][33])
+{
+  align8 u8 block[64];
+
+  block[0]=0x52;  /* OP_2 */
+  block[1]=0x21;  /* Push 33 bytes */
+  memcpy(block+2, keys[0], 33);
+  block[35]=0x21;
+  memcpy(block+36, keys[1], 28);
+
+  sha256_init(ms->midstate);
+  sha256_process(ms->midstate, block);
+  memcpy(ms->tail, keys[1]+28, 5);
+}
+
+// Compute the HASH160 of the multisig redeem scripts (see multisig_prepare())
+// for 'n' 33-byte compressed public keys stored back-to-back in 'input'. Only
+// the second SHA-256 block, starting from the cached midstate, is hashed per
+// key.
+//
+void hash160_multisig_many(u8 *output, const u8 *input, int n,
+                           const struct multisig *ms)
+{
+  align16 u8 sha_block[CHUNK*64], rmd_block[CHUNK*64], digest[CHUNK*32];
+  int i, j, count;
+
+  /* Script bytes 64-104 around the public key, then padding */
+  memset(sha_block, 0, 64);
+  memcpy(sha_block, ms->tail, 5);
+  sha_block[5]=0x21;
+  sha_block[39]=0x53;  /* OP_3 */
+  sha_block[40]=0xae;  /* OP_CHECKMULTISIG */
+  sha_block[41]=0x80;
+  sha_block[62]=(105*8) >> 8;  /* Big-endian length in bits */
+  sha_block[63]=(105*8) & 0xff;
+  rmd160_prepare(rmd_block, 32);
+  for(j=1;j < min(n, CHUNK);j++) {
+    memcpy(sha_block+j*64, sha_block, 64);
+    memcpy(rmd_block+j*64, rmd_block, 64);
+  }
+
+  for(i=0;i < n;i += CHUNK) {
+    count=min(n-i, CHUNK);
+
+    for(j=0;j < count;j++)
+      memcpy(sha_block+j*64+6, input+(i+j)*33, 33);
+    sha256_blocks(digest, sha_block, count, ms->midstate);
+
+    for(j=0;j < count;j++)
+      memcpy(rmd_block+j*64, digest+j*32, 32);
+    rmd160_blocks(output+i*20, rmd_block, count);
+  }
+}
+
+// Compute the BIP 341 key path tweaks, SHA-256 tagged with "TapTweak", of the
+// x coordinates of 'n' 33-byte compressed public keys stored back-to-back in
+// 'input'. The doubled tag hash fills the first block, so only the second
+// block, starting from a cached midstate, is hashed per key.
+//
+void taptweak_many(u8 *output, const u8 *input, int n)
+{
+  static u32 midstate[8];
+  align16 u8 block[CHUNK*64];
+  align8 u8 tag[64];
+  int i, j, count;
+
+  /* SHA-256("TapTweak") twice, hashed once per process */
+  if(!midstate[0]) {
+    sha256_prepare(tag, 8);
+    memcpy(tag, "TapTweak", 8);
+    sha256_hash(block, tag);
+    memcpy(block+32, block, 32);
+    sha256_init(midstate);
+    sha256_process(midstate, block);
+  }
+
+  /* Message bytes 64-95 are the x coordinate, then padding */
+  memset(block, 0, 64);
+  block[32]=0x80;
+  block[62]=(96*8) >> 8;  /* Big-endian length in bits */
+  block[63]=(96*8) & 0xff;
+  for(j=1;j < min(n, CHUNK);j++)
+    memcpy(block+j*64, block, 64);
+
+  for(i=0;i < n;i += CHUNK) {
+    count=min(n-i, CHUNK);
+
+    for(j=0;j < count;j++)
+      memcpy(block+j*64, input+(i+j)*33+1, 32);
+    sha256_blocks(output+i*32, block, count, midstate);
+  }
+}
+
+// Compute the 4-byte Base58Check checksum, SHA-256(SHA-256(x)), of 'n'
+// messages of 'len' bytes (at most 55) located every 'stride' bytes in 'data',
+// and store each checksum right after its message.
+//
+void checksum_many(u8 *data, int len, int stride, int n)
+{
+  align16 u8 block[CHUNK*64], digest[CHUNK*32];
+  align8 u8 pad[64], pad2[64];
+  int i, j, count;
+
+  sha256_prepare(pad, len);
+  sha256_prepare(pad2, 32);
+
+  for(i=0;i < n;i += CHUNK) {
+    count=min(n-i, CHUNK);
+
+    for(j=0;j < count;j++) {
+      memcpy(block+j*64, data+(i+j)*stride, len);
+      memcpy(block+j*64+len, pad+len, 64-len);
+    }
+    sha256_blocks(digest, block, count, NULL);
+
+    /* Second pass over the 32-byte digests */
+    for(j=0;j < count;j++) {
+      memcpy(block+j*64, digest+j*32, 32);
+      memcpy(block+j*64+32, pad2+32, 32);
+    }
+    sha256_blocks(digest, block, count, NULL);
+
+    for(j=0;j < count;j++)
+      memcpy(data+(i+j)*stride+len, digest+j*32, 4);
+  }
+}
+
+
+/**** Kernel Selection *******************************************************/
+
+static double now()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec+ts.tv_nsec/1e9;
+}
+
+// Return the best time out of several runs of sha256_blocks() with the
+// currently selected kernel, or 0 if its output differs from 'expect'.
+//
+static double bench_sha256(u8 *output, const u8 *input, const u8 *expect)
+{
+  double start, best=1e9;
+  int i;
+
+  for(i=0;i < 5;i++) {
+    start=now();
+    sha256_blocks(output, input, BENCH_BLOCKS, NULL);
+    best=min(best, now()-start);
+  }
+
+  return memcmp(output, expect, BENCH_BLOCKS*32) ? 0 : best;
+}
+
+// Same as bench_sha256(), for rmd160_blocks().
+//
+static double bench_rmd160(u8 *output, const u8 *input, const u8 *expect)
+{
+  double start, best=1e9;
+  int i;
+
+  for(i=0;i < 5;i++) {
+    start=now();
+    rmd160_blocks(output, input, BENCH_BLOCKS);
+    best=min(best, now()-start);
+  }
+
+  return memcmp(output, expect, BENCH_BLOCKS*20) ? 0 : best;
+}
+
+// Same as bench_sha256(), for keccak256_blocks() on 64-byte messages.
+//
+static double bench_keccak(u8 *output, const u8 *input, const u8 *expect)
+{
+  double start, best=1e9;
+  int i;
+
+  for(i=0;i < 5;i++) {
+    start=now();
+    keccak256_blocks(output, input, BENCH_BLOCKS);
+    best=min(best, now()-start);
+  }
+
+  return memcmp(output, expect, BENCH_BLOCKS*32) ? 0 : best;
+}
+
+// Find the index of kernel 'name' in 'list', or -1 if it does not exist or
+// needs CPU features this host does not have.
+//
+static int find_kernel(const struct hash_kernel *list, const char *name,
+                       u32 features)
+{
+  int i;
+
+  for(i=0;list[i].name;i++)
+    if(!strcmp(list[i].name, name))
+      return ((list[i].cpu_flags & features) == list[i].cpu_flags) ? i : -1;
+  return -1;
+}
+
+// Load a previous kernel selection for this CPU from the cache file. The last
+// matching entry wins. Returns 1 if all four kernels were found.
+//
+static bool load_cache(const char *path, const char *cpu, u32 features,
+                       int *sha1, int *shaN, int *rmd, int *kec)
+{
+  char line[256], id[64], name[4][32];
+  FILE *fp;
+  bool ok=0;
+
+  if(!(fp=fopen(path, "r")))
+    return 0;
+
+  while(fgets(line, sizeof(line), fp))
+    if(sscanf(line, "%63s %31s %31s %31s %31s", id, name[0], name[1],
+              name[2], name[3]) == 5 && !strcmp(id, cpu)) {
+      *sha1=find_kernel(sha256_kernels, name[0], features);
+      *shaN=find_kernel(sha256_kernels, name[1], features);
+      *rmd=find_kernel(rmd160_kernels, name[2], features);
+      *kec=find_kernel(keccak_kernels, name[3], features);
+      ok=(*sha1 >= 0 && *shaN >= 0 && *rmd >= 0 && *kec >= 0 &&
+          sha256_kernels[*sha1].lanes == 1);
+    }
+
+  fclose(fp);
+  return ok;
+}
+
+// Benchmark every SHA-256, RIPEMD-160 and Keccak-256 kernel this CPU
+// supports, including the multi-buffer ones, and return the fastest of each
+// kind. Returns 0 if out of memory, leaving the generic kernels.
+//
+static bool run_benchmark(u32 features, bool verbose, int *sha1, int *shaN,
+                          int *rmd, int *kec)
+{
+  double t, best1=1e9, bestN=1e9, bestR=1e9, bestK=1e9;
+  u8 *input, *output, *expect;
+  int i;
+
+  *sha1=*shaN=*rmd=*kec=0;
+  if(!(input=malloc(BENCH_BLOCKS*(64+32+32)))) {
+    perror("malloc");
+    return 0;
+  }
+  output=input+BENCH_BLOCKS*64;
+  expect=output+BENCH_BLOCKS*32;
+
+  for(i=0;i < BENCH_BLOCKS*64;i++)
+    input[i]=i*131+(i >> 8);
+
+  /* Reference output from the generic kernels */
+  sha256_use_kernel(0);
+  sha256_blocks(expect, input, BENCH_BLOCKS, NULL);
+
+  for(i=0;sha256_kernels[i].name;i++) {
+    if((sha256_kernels[i].cpu_flags & features) !=
+       sha256_kernels[i].cpu_flags)
+      continue;
+    sha256_use_kernel(i);
+    t=bench_sha256(output, input, expect);
+    if(verbose)
+      fprintf(stderr, "SHA-256 %-11s %6.1f Mblock/s%s\n",
+              sha256_kernels[i].name, t ? BENCH_BLOCKS/t/1e6 : 0,
+              t ? "" : " (failed self-test)");
+    if(!t)
+      continue;
+    if(sha256_kernels[i].lanes == 1 && t < best1)
+      best1=t, *sha1=i;
+    if(t < bestN)
+      bestN=t, *shaN=i;
+  }
+
+  rmd160_use_kernel(0);
+  rmd160_blocks(expect, input, BENCH_BLOCKS);
+
+  for(i=0;rmd160_kernels[i].name;i++) {
+    if((rmd160_kernels[i].cpu_flags & features) !=
+       rmd160_kernels[i].cpu_flags)
+      continue;
+    rmd160_use_kernel(i);
+    t=bench_rmd160(output, input, expect);
+    if(verbose)
+      fprintf(stderr, "RMD-160 %-11s %6.1f Mblock/s%s\n",
+              rmd160_kernels[i].name, t ? BENCH_BLOCKS/t/1e6 : 0,
+              t ? "" : " (failed self-test)");
+    if(t && t < bestR)
+      bestR=t, *rmd=i;
+  }
+
+  keccak_use_kernel(0);
+  keccak256_blocks(expect, input, BENCH_BLOCKS);
+
+  for(i=0;keccak_kernels[i].name;i++) {
+    if((keccak_kernels[i].cpu_flags & features) !=
+       keccak_kernels[i].cpu_flags)
+      continue;
+    keccak_use_kernel(i);
+    t=bench_keccak(output, input, expect);
+    if(verbose)
+      fprintf(stderr, "Keccak  %-11s %6.1f Mblock/s%s\n",
+              keccak_kernels[i].name, t ? BENCH_BLOCKS/t/1e6 : 0,
+              t ? "" : " (failed self-test)");
+    if(t && t < bestK)
+      bestK=t, *kec=i;
+  }
+
+  free(input);
+  return 1;
+}
+
+// Select the fastest SHA-256, RIPEMD-160 and Keccak-256 kernels for this
+// host. The choice is made by benchmarking, since CPUID order alone can be
+// wrong (e.g. AVX-512 frequency throttling), and is cached in ~/.vanitygen
+// keyed by the CPU signature so that later runs start immediately. 'rebench'
+// ignores the cache.
+//
+void hash160_register(bool verbose, bool rebench)
+{
+  char cpu[64], path[1024], *home=getenv("HOME");
+  u32 signature, features=get_cpu_features(&signature);
+  int sha1, shaN, rmd, kec;
+  FILE *fp;
+
+  sprintf(cpu, "%08x:%02x", signature, features);
+  snprintf(path, sizeof(path), "%s/" CACHE_FILE, home ?: ".");
+
+  if((rebench || !load_cache(path, cpu, features, &sha1, &shaN, &rmd, &kec)) &&
+     run_benchmark(features, verbose, &sha1, &shaN, &rmd, &kec)) {
+    /* Save the selection; failure to do so is not an error */
+    if((fp=fopen(path, "a"))) {
+      fprintf(fp, "%s %s %s %s %s\n", cpu, sha256_kernels[sha1].name,
+              sha256_kernels[shaN].name, rmd160_kernels[rmd].name,
+              keccak_kernels[kec].name);
+      fclose(fp);
+    }
+  }
+
+  /* Single-lane kernel first, since multi-lane kernels only set batching */
+  sha256_use_kernel(sha1);
+  sha256_use_kernel(shaN);
+  rmd160_use_kernel(rmd);
+  keccak_use_kernel(kec);
+
+  if(verbose)
+    fprintf(stderr, "SHA-256 kernel: %s (batch: %s); RIPEMD-160 kernel: %s; "
+            "Keccak-256 kernel: %s\n", sha256_kernels[sha1].name,
+            sha256_kernels[shaN].name, rmd160_kernels[rmd].name,
+            keccak_kernels[kec].name);
+}
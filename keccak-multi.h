@@ -0,0 +1,90 @@
+/* keccak-multi.h - Multi-buffer Keccak-256 kernel template */
+
+// This file is included by keccak.c once for each vector width. Before
+// inclusion, define:
+//
+//   VEC     A GCC vector type of 64-bit unsigned integers
+//   LANES   Number of elements in VEC
+//   KERNEL  Name of the function to generate
+//
+// The generated function hashes 'n' independent 64-byte messages, LANES at a
+// time, with one message per vector lane. A 64-byte message fits in a single
+// 136-byte block, so each takes exactly one permutation.
+
+#define VROL(x,n) (((x) << (n)) | ((x) >> (64-(n))))
+
+static void KERNEL(char *output, const char *input, int n)
+{
+  VEC A[25], C[5], D, temp;
+  u64 *out;
+  int i, j, k, r, lanes;
+
+  for(k=0;k < n;k += LANES) {
+    lanes=min(n-k, LANES);
+
+    /* Transpose messages into vectors of little-endian words */
+    for(j=0;j < lanes;j++)
+      for(i=0;i < 8;i++)
+        A[i][j]=le64(((const u64 *)(input+(k+j)*64))[i]);
+    for(;j < LANES;j++)
+      for(i=0;i < 8;i++)
+        A[i][j]=0;
+
+    /* Padding at bytes 64 and 135 of the block; the capacity is zero */
+    for(i=8;i < 25;i++)
+      A[i]=(VEC){};
+    A[8] += 0x01;
+    A[16] += 0x8000000000000000ULL;
+
+    for(r=0;r < 24;r++) {
+      /* Theta */
+#pragma GCC unroll 5
+      for(i=0;i < 5;i++)
+        C[i]=A[i] ^ A[i+5] ^ A[i+10] ^ A[i+15] ^ A[i+20];
+#pragma GCC unroll 5
+      for(i=0;i < 5;i++) {
+        D=C[(i+4)%5] ^ VROL(C[(i+1)%5], 1);
+#pragma GCC unroll 5
+        for(j=0;j < 25;j += 5)
+          A[j+i] ^= D;
+      }
+
+      /* Rho and pi */
+      temp=A[1];
+#pragma GCC unroll 24
+      for(i=0;i < 24;i++) {
+        D=A[keccak_pi[i]];
+        A[keccak_pi[i]]=VROL(temp, keccak_rho[i]);
+        temp=D;
+      }
+
+      /* Chi */
+#pragma GCC unroll 5
+      for(j=0;j < 25;j += 5) {
+#pragma GCC unroll 5
+        for(i=0;i < 5;i++)
+          C[i]=A[j+i];
+#pragma GCC unroll 5
+        for(i=0;i < 5;i++)
+          A[j+i] ^= ~C[(i+1)%5] & C[(i+2)%5];
+      }
+
+      /* Iota */
+      A[0] ^= keccak_rc[r];
+    }
+
+    /* Save output */
+    for(j=0;j < lanes;j++) {
+      out=(u64 *)(output+(k+j)*32);
+      out[0]=le64(A[0][j]);
+      out[1]=le64(A[1][j]);
+      out[2]=le64(A[2][j]);
+      out[3]=le64(A[3][j]);
+    }
+  }
+}
+
+#undef VROL
+#undef VEC
+#undef LANES
+#undef KERNEL
@@ -0,0 +1,204 @@
+/* keccak.c - Keccak-256 hashing and Ethereum address encoding */
+
+// Ethereum uses the original Keccak submission padding (0x01), not the one
+// later standardized as SHA3-256 (0x06).
+
+#include "externs.h"
+
+static void keccak256_blocks_x1(char *output, const char *input, int n);
+static void keccak256_blocks_x2(char *output, const char *input, int n);
+#ifdef __x86_64__
+static void keccak256_blocks_x4(char *output, const char *input, int n);
+static void keccak256_blocks_x8(char *output, const char *input, int n);
+#endif
+
+static void (*keccak256_blocks_func)(char *output, const char *input, int n)=
+  keccak256_blocks_x1;
+
+const struct hash_kernel keccak_kernels[]={
+  {"generic",    1, 0},
+  {"vec2",       2, 0},
+#ifdef __x86_64__
+  {"avx2-x4",    4, CPU_AVX2},
+  {"avx512-x8",  8, CPU_AVX512},
+#endif
+  {NULL}
+};
+
+/* Round constants */
+static const u64 keccak_rc[24]={
+  0x0000000000000001, 0x0000000000008082, 0x800000000000808a,
+  0x8000000080008000, 0x000000000000808b, 0x0000000080000001,
+  0x8000000080008081, 0x8000000000008009, 0x000000000000008a,
+  0x0000000000000088, 0x0000000080008009, 0x000000008000000a,
+  0x000000008000808b, 0x800000000000008b, 0x8000000000008089,
+  0x8000000000008003, 0x8000000000008002, 0x8000000000000080,
+  0x000000000000800a, 0x800000008000000a, 0x8000000080008081,
+  0x8000000000008080, 0x0000000080000001, 0x8000000080008008,
+};
+
+/* Rotate amounts and lane order of the combined rho and pi steps */
+static const u8 keccak_rho[24]={
+   1,  3,  6, 10, 15, 21, 28, 36, 45, 55,  2, 14,
+  27, 41, 56,  8, 25, 43, 62, 18, 39, 61, 20, 44,
+};
+
+static const u8 keccak_pi[24]={
+  10,  7, 11, 17, 18,  3,  5, 16,  8, 21, 24,  4,
+  15, 23, 19, 13, 12,  2, 20, 14, 22,  9,  6,  1,
+};
+
+#define ROL64(x,n) (((x) << (n)) | ((x) >> (64-(n))))
+
+static void keccak_f(u64 A[25])
+{
+  u64 C[5], D, temp;
+  int i, j, r;
+
+  for(r=0;r < 24;r++) {
+    /* Theta */
+#pragma GCC unroll 5
+    for(i=0;i < 5;i++)
+      C[i]=A[i] ^ A[i+5] ^ A[i+10] ^ A[i+15] ^ A[i+20];
+#pragma GCC unroll 5
+    for(i=0;i < 5;i++) {
+      D=C[(i+4)%5] ^ ROL64(C[(i+1)%5], 1);
+#pragma GCC unroll 5
+      for(j=0;j < 25;j += 5)
+        A[j+i] ^= D;
+    }
+
+    /* Rho and pi */
+    temp=A[1];
+#pragma GCC unroll 24
+    for(i=0;i < 24;i++) {
+      D=A[keccak_pi[i]];
+      A[keccak_pi[i]]=ROL64(temp, keccak_rho[i]);
+      temp=D;
+    }
+
+    /* Chi */
+#pragma GCC unroll 5
+    for(j=0;j < 25;j += 5) {
+#pragma GCC unroll 5
+      for(i=0;i < 5;i++)
+        C[i]=A[j+i];
+#pragma GCC unroll 5
+      for(i=0;i < 5;i++)
+        A[j+i] ^= ~C[(i+1)%5] & C[(i+2)%5];
+    }
+
+    /* Iota */
+    A[0] ^= keccak_rc[r];
+  }
+}
+
+// Hash a message of 'len' bytes (at most 135) from 'input' and store the
+// 32-byte digest to 'output'.
+//
+void keccak256(char *output, const char *input, int len)
+{
+  align8 u8 block[136];
+  u64 A[25];
+  int i;
+
+  memset(block, 0, sizeof(block));
+  memcpy(block, input, len);
+  block[len] ^= 0x01;
+  block[135] ^= 0x80;
+
+  for(i=0;i < 17;i++)
+    A[i]=le64(((u64 *)block)[i]);
+  for(;i < 25;i++)
+    A[i]=0;
+
+  keccak_f(A);
+
+  for(i=0;i < 4;i++)
+    ((u64 *)output)[i]=le64(A[i]);
+}
+
+// Hash 'n' independent 64-byte messages from 'input', storing n 32-byte
+// digests to 'output'.
+//
+void keccak256_blocks(char *output, const char *input, int n)
+{
+  keccak256_blocks_func(output, input, n);
+}
+
+static void keccak256_blocks_x1(char *output, const char *input, int n)
+{
+  int i;
+
+  for(i=0;i < n;i++)
+    keccak256(output+i*32, input+i*64, 64);
+}
+
+/* Generic 2-lane kernel (SSE2 on x86_64, NEON on arm64) */
+typedef u64 v2u64 __attribute__((vector_size(16)));
+#define VEC v2u64
+#define LANES 2
+#define KERNEL keccak256_blocks_x2
+#include "keccak-multi.h"
+
+#ifdef __x86_64__
+
+#pragma GCC push_options
+#pragma GCC target("avx2")
+typedef u64 v4u64 __attribute__((vector_size(32)));
+#define VEC v4u64
+#define LANES 4
+#define KERNEL keccak256_blocks_x4
+#include "keccak-multi.h"
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+typedef u64 v8u64 __attribute__((vector_size(64)));
+#define VEC v8u64
+#define LANES 8
+#define KERNEL keccak256_blocks_x8
+#include "keccak-multi.h"
+#pragma GCC pop_options
+
+#endif
+
+// Select kernel number 'k' from keccak_kernels[] for keccak256_blocks().
+//
+void keccak_use_kernel(int k)
+{
+  static void (*const blocks[])(char *, const char *, int)={
+    keccak256_blocks_x1, keccak256_blocks_x2,
+#ifdef __x86_64__
+    keccak256_blocks_x4, keccak256_blocks_x8,
+#endif
+  };
+
+  keccak256_blocks_func=blocks[k];
+}
+
+// Encode the 20-byte Ethereum address 'addr' into 'output' (43 bytes) as
+// "0x" and 40 hex digits, with letters capitalized according to the EIP-55
+// checksum: a letter is uppercase if the matching nibble of the Keccak-256
+// hash of the lowercase hex address is 8 or more.
+//
+void eth_encode(char *output, const u8 addr[20])
+{
+  static const char hex[]="0123456789abcdef";
+  u8 digest[32];
+  int i;
+
+  output[0]='0';
+  output[1]='x';
+  output += 2;
+  for(i=0;i < 20;i++) {
+    output[i*2]=hex[addr[i] >> 4];
+    output[i*2+1]=hex[addr[i] & 15];
+  }
+  output[40]='\0';
+
+  keccak256(digest, output, 40);
+  for(i=0;i < 40;i++)
+    if(output[i] >= 'a' && (digest[i/2] << (i & 1)*4) & 0x80)
+      output[i] -= 32;
+}
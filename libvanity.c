@@ -0,0 +1,5801 @@
+/* libvanity.c - Super Vanitygen search engine library */
+
+// Copyright (C) 2016 Byron Stanoszek  <gandalf@winds.org>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "externs.h"
+#include "vanity.h"
+
+/* Number of secp256k1 operations per batch */
+#define STEP 3072
+
+/* Results buffered per worker in high hit-rate mode (power of 2) */
+#define RING_SIZE 1024
+
+/* Maximum number of results verified together by the manager */
+#define VERIFY_BATCH 256
+
+/* Per-worker output buffer size in bulk generation mode */
+#define OUTBUF_SIZE (1 << 20)
+
+/* Bulk generation output formats */
+#define GEN_CSV 1  // WIF,address lines
+#define GEN_BIN 2  // 52-byte (PrivKey,PubKey) records
+
+/* Minimum number of prefixes per process when compiling a long list */
+#define PARALLEL_MIN 4096
+
+/* Pattern lookup buckets, by the first 16 bits of the hashed public key */
+#define NUM_BUCKETS 65536
+
+/* Seconds between checkpoints of a seeded search */
+#define CHECKPOINT_INTERVAL 60
+
+/* Keys per chunk claimed by a worker in a range scan (a multiple of STEP) */
+#define RANGE_CHUNK (STEP*256)
+
+/* Baby-step table files, and the offset of the table in one */
+#define BSGS_MAGIC   "VGBSTEP"
+#define BSGS_VERSION 1
+#define BSGS_TABLE   64
+
+/* Nodes served at once by a coordinator, and keys per range chunk handed to
+   a node */
+#define MAX_NODES  64
+#define NODE_CHUNK (1ULL << 32)
+
+/* Daemon jobs queued or running at once, arguments of a job, and the least
+   capacity of a pattern table published to the workers */
+#define MAX_REQUESTS   64
+#define MAX_JOB_ARGS   65536
+#define TABLE_PATTERNS 65536
+#define TABLE_BECH32   1024
+
+/* Pattern index cache files, relative to $HOME */
+#define INDEX_DIR     ".cache/vanitygen"
+#define INDEX_MAGIC   "VGINDEX"
+#define INDEX_VERSION 1
+
+/* Offsets of the bucket table and patterns in a pattern index file */
+#define INDEX_BUCKETS  64
+#define INDEX_PATTERNS ((INDEX_BUCKETS+(NUM_BUCKETS+1)*4+63) & ~63)
+
+#include "src/libsecp256k1-config.h"
+#include "src/secp256k1.c"
+
+/* List of public key byte patterns to match */
+static struct pattern {
+  align8 u8 low[20];   // Low limit
+  align8 u8 high[20];  // High limit
+} *patterns;
+
+static int num_patterns, max_patterns;
+
+// Prefilter for the sorted patterns[] array: pattern_buckets[t] is the index
+// of the first pattern whose low limit starts with 16 bits >= t, so a key only
+// has to be searched for among a bucket's patterns and the one before them.
+static u32 *pattern_buckets;
+
+/* Header of a pattern index file, followed by the buckets and patterns */
+struct index_header {
+  char magic[8];     // INDEX_MAGIC
+  u32 version;       // INDEX_VERSION
+  u32 num_patterns;  // Number of patterns
+  u64 key;           // Hash of the input list and options
+  u64 size;          // Total file size
+};
+
+/* Prefixes, suffixes or words given on the command line or with -f */
+static char **inputs;
+static int num_inputs;
+
+// Networks whose addresses are derived from the same hashed public key. A
+// key's hash is matched against the prefixes of all of them at once, and each
+// match is reported with the address, WIF and name of its network.
+static const struct network {
+  const char *name;
+  const char *lead;      // First characters of Base58 P2PKH addresses
+  u8 version;            // Base58 P2PKH version byte
+  u8 wif;                // WIF version byte
+  const char *hrp;       // Bech32 human-readable part, or NULL
+  const char *cashaddr;  // CashAddr prefix, or NULL
+} networks[]={
+  {"Bitcoin",      "13", 0x00, 0x80, "bc",  NULL},
+  {"Litecoin",     "L",  0x30, 0xb0, "ltc", NULL},
+  {"Dogecoin",     "D",  0x1e, 0x9e, NULL,  NULL},
+  {"Testnet",      "mn", 0x6f, 0xef, "tb",  NULL},
+  {"Bitcoin Cash", "",   0x00, 0x80, NULL,  "bitcoincash"},
+};
+
+/* Address encodings recognized by get_network() */
+#define ENC_BASE58   0
+#define ENC_BECH32   1
+#define ENC_CASHADDR 2
+
+/* Networks with Base58 prefixes, and with prefixes of any kind, by bit */
+static u8 base58_networks, used_networks;
+
+/* Bech32 (bc1q) and CashAddr prefixes as mask/value pairs on the first 64
+   bits of the hashed public key, or taproot (bc1p) prefixes on the output
+   key */
+static struct bech32_pattern {
+  u64 mask, value;
+  u8 network;     // Index into networks[]
+  bool cashaddr;  // CashAddr rather than bech32
+} *bech32_patterns;
+
+static int num_bech32;
+
+/* Ethereum (0x) prefixes as mask/value pairs on the first 64 bits of the
+   address */
+static struct eth_pattern {
+  u64 mask, value;
+  const char *checksum;  // Prefix whose case must match EIP-55, or NULL
+} *eth_patterns;
+
+static int num_eth;
+
+// Multiples 1..255 of 256^(31-i)*G in tweak_table[i], so that the tweak point
+// tG of a taproot key is the sum of one table entry per nonzero byte of t.
+static secp256k1_ge_storage (*tweak_table)[256];
+
+/* List of address suffixes to match, as numbers (see b58tail_addr) */
+static struct suffix {
+  u64 value;  // Suffix digits as a Base58 number
+  int len;    // Number of digits
+} *suffixes;
+
+static int num_suffixes;
+
+/* Distinct suffix lengths; suffixes[] is sorted by length, then value */
+static struct {
+  int start, end;  // Range of suffixes[] with this length
+  u64 modulus;     // 58^length
+} suffix_lens[10];
+
+static int num_suffix_lens;
+
+// Case-insensitive Base58 prefixes (-i), matched on the leading digits of
+// addresses rather than expanded into a pattern for every case variant. Heads
+// are the first B58_HEAD_DIGITS characters of prefixes, case folded to 6-bit
+// symbols; heads[] is sorted by length, then value. Longer prefixes are
+// compared in full once their head matches.
+static struct head {
+  u64 value;           // Folded characters, the first one highest
+  int len;             // Number of characters
+  const char *prefix;  // Whole prefix
+} *heads;
+
+static int num_heads;
+
+/* Distinct head lengths */
+static struct {
+  int start, end;  // Range of heads[] with this length
+  int shift;       // Bits to drop from a whole address head
+} head_lens[B58_HEAD_DIGITS];
+
+static int num_head_lens;
+static double head_freq;  // Chance of an address matching any head
+
+/* Character to folded symbol, or 0 if not Base58 in either case */
+static u8 fold_symbol[256];
+static u8 digit_symbol[58];
+
+// Aho-Corasick automaton for finding words anywhere in an address. States are
+// trie nodes (state 0 is the root) over the Base58 symbols; compile_words()
+// fills in the missing transitions from the failure links, so matching takes
+// exactly one table lookup per address character.
+static int (*word_next)[58];  // State transitions by symbol
+static int *word_out;         // Word found on entering a state, or -1
+static int num_word_states;
+
+static char **words;
+static int num_words;
+
+/* Base58 character to automaton symbol, or -1; case folded with -i */
+static s16 word_symbol[256];
+static int word_symbol_count[58];
+
+// Single-producer/single-consumer queue of (PrivKey,PubKey) results, one per
+// worker, in shared memory. Only the worker writes 'head' and only the manager
+// writes 'tail'; both count up freely and are reduced modulo RING_SIZE.
+static struct result_ring {
+  align64 volatile u32 head;
+  align64 volatile u32 tail;
+  u8 result[RING_SIZE][52];
+} *rings;
+
+/* Global command-line settings */
+static int  max_count=1;
+static bool count_given;
+static bool anycase;
+static bool eth_mode;
+static bool keep_going;
+static bool no_rekey;
+static bool quiet;
+static bool p2sh_mode;
+static struct multisig *multisig;
+static bool rebench;
+static bool suffix_mode;
+static bool taproot_mode;
+static bool verbose;
+static bool word_mode;
+static bool fold_mode;  // Match -i prefixes by heads, not patterns
+
+/* Fixed cosigner keys for 2-of-3 multisig addresses (-m) */
+static u8 cosigners[2][33];
+
+// Customer public key A for split-key searches (-p). Keys are searched as
+// A+kG, and only the partial private key k is reported; the customer adds it
+// to their own private key.
+static secp256k1_ge split_base;
+static bool split_mode;
+
+// Split-key orders read with -P, searched together in one batch: each order
+// advances its own segment of every batch from its own public key, and has its
+// own prefixes. load_order() swaps an order's patterns into the globals used
+// for matching.
+static struct order {
+  secp256k1_ge base;     // Customer public key A
+  char *pubkey;          // A in hex, as given
+  char **inputs;         // Prefixes of this order
+  int num_inputs;
+  struct pattern *patterns;
+  u32 *pattern_buckets;
+  int num_patterns;
+  struct bech32_pattern *bech32_patterns;
+  int num_bech32;
+  int found;             // Results announced so far (manager only)
+} *orders;
+
+static int num_orders, current_order;
+static u8 *orders_done;  // Shared flags for orders that need no more results
+
+// Seeded search state (-C). Worker i scans upward from master+i*2^192, where
+// the master key is derived from a random seed. The seed, each worker's
+// position and the result statistics are saved to the checkpoint file, so an
+// interrupted search resumes exactly where it left off.
+static struct {
+  const char *path;    // Checkpoint file, or NULL for random starting keys
+  u8 seed[32];
+  int threads;         // Number of workers the ranges are split between
+  int found;           // Results announced before this run
+  u64 last_result;     // Key count at the last result
+  u64 *positions;      // Keys scanned by each worker (shared)
+} checkpoint;
+
+// Private key range scan (-R). The range is split into chunks of RANGE_CHUNK
+// keys that workers claim from a shared counter as they go, so fast and slow
+// cores finish together, and the search ends once every chunk is scanned.
+static struct {
+  u64 start[4];     // First key of the range, in cpu endianness
+  u64 span[2];      // Last key minus the first, most significant first
+  u64 keys;         // Number of keys in the range, or giant steps with -b
+  u64 *next_chunk;  // Next chunk to be claimed (shared)
+} range;
+
+static bool range_mode;
+
+// Baby-step giant-step search for the private key of a known public key Q in
+// a -R range (-b). The baby-step table holds fingerprints of the x coordinates
+// of jG for j=1..m in an open-addressed hash table. As -jG has the same x, a
+// giant step R=Q-cG covers the 2m+1 keys c-m..c+m with a single lookup. The
+// centers c are S=2m+1 apart, and workers claim them in range scan chunks.
+static struct {
+  u8 pubkey[33];             // Q, compressed
+  u8 hash[20];               // Hash of Q, as sent up with the private key
+  secp256k1_ge target;       // Q
+  secp256k1_scalar first;    // Center of the first giant step, start+m
+  secp256k1_scalar stride;   // S
+  const char *path;          // Table file (-T), or NULL
+  int memory;                // Memory limit of the table in megabytes (-M)
+  int bits;                  // log2 of the number of slots
+  u64 baby_steps;            // m
+  u64 *table;                // Slots of j << 32 | fingerprint, 0 if empty
+} bsgs;
+
+static bool bsgs_mode;
+
+/* Header of a baby-step table file, followed by the table at BSGS_TABLE */
+struct bsgs_header {
+  char magic[8];    // BSGS_MAGIC
+  u32 version;      // BSGS_VERSION
+  u32 bits;         // log2 of the number of slots
+  u64 baby_steps;   // m
+  u64 size;         // Total file size
+};
+
+// Distributed search. A coordinator (-S port) hands its search to nodes that
+// join it over TCP (-J host:port) as a list of arguments: the options and
+// prefixes, plus a chunk of NODE_CHUNK keys of a range scan. Nodes send up
+// their key counts and unverified results as text lines. A relay process
+// feeds these to the coordinator's manager loop as if they came from local
+// workers, and sends "STOP" to every node when the coordinator exits.
+static int coord_fd=-1;    // Node: connection to the coordinator
+static int listen_fd=-1;   // Coordinator: listening socket
+static char **job_args;    // Coordinator: arguments handed to nodes
+static int num_job_args;
+static volatile sig_atomic_t relay_stop;
+
+// Daemon mode (-D path). The workers are started once and stay warm between
+// jobs, which clients send over a unix socket in the format of coordinator
+// jobs: "JOB n", then n argument lines (-c count, -i, -k and prefixes). Each
+// job is sent its results as tab-separated "RESULT n address key network"
+// lines, one per address, then "DONE found" when complete. A job that can't
+// be run gets "ERROR message".
+//
+// Jobs run together on the same workers. Each job's prefixes are compiled on
+// their own, as for split-key orders, and the patterns of all running jobs
+// are merged into one table, so every key is matched against all jobs at
+// once. The manager tells which job a result is for by matching it against
+// each job's own patterns. A job retires once it has its count, and queued
+// jobs start as soon as their patterns fit in the table.
+static struct request {
+  int fd;            // Client connection, or -1 if the slot is free
+  int len;           // Bytes buffered in 'line'
+  char **args;       // Arguments of "JOB n", as received
+  int num_args, args_read;
+  char **inputs;     // Prefixes, from 'args'
+  int num_inputs;
+  int count;         // Results wanted (-c)
+  bool anycase;      // -i
+  bool keep_going;   // -k
+  bool queued;       // Compiled, and waiting to run or running
+  bool running;      // Patterns published to the workers
+  u32 seq;           // Order of arrival
+  int found;         // Results sent
+  struct pattern *patterns;
+  u32 *pattern_buckets;
+  int num_patterns;
+  struct bech32_pattern *bech32_patterns;
+  int num_bech32;
+  u8 base58_networks, used_networks;
+  char line[1024];
+} requests[MAX_REQUESTS];
+
+static int daemon_fd=-1;        // Listening socket
+static int current_request=-1;  // Job loaded for matching, or -1
+static u32 next_seq;
+
+// Per-prefix targets (-n count). A prefix retires once it has 'count' results,
+// and the manager recompiles the prefixes still wanted and publishes them to
+// the workers in a pattern table, as for daemon jobs, so found prefixes stop
+// costing compares. With -f, SIGHUP adds the new prefixes of the list file.
+static struct target {
+  char *prefix;
+  bool base58;  // Case-sensitive unless -i; other encodings never are
+  int found;    // Results announced
+} *targets;
+
+static int num_targets, target_count, targets_left;
+static bool targets_changed;  // Some retired since the last recompile
+static time_t next_retire;    // Earliest time of the next recompile
+static volatile sig_atomic_t reload_requested;
+
+// Merged patterns of the running daemon jobs, or the prefixes still wanted
+// with -n, published to the workers in shared memory, RCU style. The manager
+// fills in the table that no worker is using and then bumps epochs[0];
+// between batches, workers switch to table epochs[0]&1 and record the epoch
+// they match with in epochs[thread+1]. So a table is only rewritten once every
+// worker has moved off it, and workers never wait for the manager. Idle
+// workers sleep on epochs[0].
+static struct table {
+  int num_patterns, num_bech32;
+  u32 buckets[NUM_BUCKETS+1];
+  struct bech32_pattern bech32[TABLE_BECH32];
+  struct pattern patterns[];  // 'table_size' of them
+} *tables[2];
+
+static u32 *epochs;
+static int table_size=TABLE_PATTERNS;
+
+/* Worker process IDs, or 0 once stopped */
+static pid_t *workers;
+
+/* Bulk generation mode settings */
+static int gen_format;
+static int out_fd=1;
+static int out_chunk=OUTBUF_SIZE;
+static u64 *gen_issued;  // Shared count of keys claimed by workers
+static u64 *gen_failed;  // Shared flag, set once writing the output failed
+
+/* Difficulty (1 in x) */
+static double difficulty;
+
+/* Per-thread hash counter */
+static u64 *thread_count;
+
+/* Socket pair for sending up results */
+static int sock[2];
+
+/* Options given with vanity_set_option(), applied by vanity_start() */
+static struct {
+  char *out_path, *list_path, *keys, *split_key, *orders_path;
+  char *checkpoint_path, *range_arg, *bsgs_key, *coord_port, *daemon_path;
+} options;
+
+/* State of the job run by the manager, in the calling process */
+struct vanity_job {
+  vanity_callback callback;       // Result callback, or NULL to queue them
+  void *arg;
+  struct vanity_result *results;  // Queued results
+  int num_results, next_result;
+  int threads;                    // Entries of thread_count[]
+  int procs;                      // Worker processes
+  int found;                      // Results announced
+  bool started, finished, stopped;
+  bool failed;                    // A result could not be delivered
+  u64 last_result;                // Key count at the last result
+  u64 prev;                       // Key count at the last update
+  u64 count_avg[8];               // Keys counted in the last 8 updates
+  int count_index, count_max;
+  u64 rate;                       // Average keys per second
+  time_t next_checkpoint;
+};
+
+/* Static Functions */
+static void stop_workers(struct vanity_job *job);
+static void end_search(struct vanity_job *job);
+static void drain_rings(struct vanity_job *job);
+static void collect_results(struct vanity_job *job);
+static void discard_results(struct vanity_job *job);
+static bool check_result(const u8 result[52]);
+static void announce_result(struct vanity_job *job, const u8 result[52]);
+static int get_addresses(const u8 result[52], int *nets,
+                         char (*addresses)[112]);
+static bool match_input(const char *address);
+static bool parse_cosigners(const char *arg);
+static bool parse_split_key(const char *arg);
+static bool parse_pubkey(secp256k1_ge *ge, const char *arg);
+static bool load_orders(const char *path);
+static void load_order(int n);
+static void store_order(int n);
+static int find_order(const u8 result[52]);
+static bool add_input(char *str);
+static bool load_list(const char *path);
+static bool compile_prefixes(int threads, const char *list_path);
+static bool build_patterns(int threads);
+static u64 index_key(void);
+static bool load_index(u64 key);
+static void save_index(u64 key);
+static bool add_prefix(const char *prefix);
+static bool add_anycase_prefix(const char *prefix);
+static bool add_version_prefix(const char *prefix, int version,
+                               const char *type);
+static int get_network(const char *prefix, int *encoding);
+static bool add_bech32_prefix(const char *prefix);
+static bool add_cashaddr_prefix(const char *prefix);
+static void compile_bech32(void);
+static bool add_eth_prefix(const char *prefix);
+static bool add_anycase(const char *str, bool (*add)(const char *));
+static bool add_suffix(const char *suffix);
+static void compile_suffixes(void);
+static bool add_head(const char *prefix);
+static void compile_heads(void);
+static bool match_head(const u8 *hash);
+static bool match_prefix(void *pubkey);
+static bool match_bech32(const u8 *pubkey);
+static bool match_eth(const u8 *address);
+static bool taproot_prepare(void);
+static void taproot_keys(u8 (*xonly)[32], bool *skip,
+                         const secp256k1_ge *points, const u8 (*pubkeys)[33]);
+static bool match_suffix(const u8 payload[25]);
+static bool add_word(const char *word);
+static bool compile_words(void);
+static int match_word(const char *address);
+static double get_difficulty(void);
+static double get_suffix_difficulty(void);
+static double get_pattern_space(const struct pattern *p, int n);
+static double get_word_difficulty(void);
+static bool load_checkpoint(const char *path, int *threads);
+static void save_checkpoint(u64 last_result, int found);
+static void get_seeded_key(u64 privkey[4], int thread);
+static bool parse_range(const char *arg);
+static bool next_chunk(u64 *pos, u64 *left);
+static bool claim_chunk(u64 privkey[4], u64 *left);
+static bool parse_bsgs_key(const char *arg);
+static bool bsgs_prepare(int threads);
+static void bsgs_engine(int thread);
+static bool serve_nodes(const char *port);
+static void add_job_arg(const char *arg);
+static void relay(int threads);
+static bool serve_requests(const char *path);
+static void serve_clients(struct vanity_job *job, fd_set *readset);
+static void read_request(struct vanity_job *job, int n);
+static bool parse_request(struct request *req);
+static bool compile_request(struct vanity_job *job, int n);
+static void load_request(int n);
+static void start_requests(struct vanity_job *job, bool changed);
+static void publish_table(struct vanity_job *job);
+static void merge_requests(struct table *table);
+static int find_request(const u8 result[52]);
+static void reject_request(struct vanity_job *job, int n, const char *msg);
+static void end_request(struct vanity_job *job, int n, bool done);
+static bool init_targets(void);
+static bool add_target(char *prefix);
+static bool compile_targets(void);
+static int match_targets(char (*addresses)[112], int n, bool credit);
+static bool wanted_key(const u8 result[52]);
+static void retire_targets(struct vanity_job *job);
+static void reload_signal(int sig);
+static void add_targets(struct vanity_job *job);
+static void load_table(int thread);
+static void engine(int thread);
+static void get_key(u8 key[32], const u64 privkey[4], int k);
+static bool emit_keys(const u64 privkey[4], const u8 (*hashes)[20]);
+static void get_pubkey(u8 pubkey[33], const u8 privkey[32]);
+static void get_taproot_key(u8 xonly[32], const u8 privkey[32]);
+static bool verify_key(const u8 result[52]);
+static void verify_keys(const u8 (*results)[52], bool *valid, int n);
+
+static void my_secp256k1_ge_set_all_gej_var(secp256k1_ge *r,
+                                            const secp256k1_gej *a);
+static void my_secp256k1_gej_add_ge_var(secp256k1_gej *r,
+                                        const secp256k1_gej *a,
+                                        const secp256k1_ge *b);
+
+
+/**** Library Interface ******************************************************/
+
+// Create the job of this process, which runs a single job as the search state
+// is global. Returns NULL on error.
+//
+struct vanity_job *vanity_create()
+{
+  static bool created;
+  struct vanity_job *job;
+
+  if(created) {
+    fprintf(stderr, "Error: A process runs a single job.\n");
+    return NULL;
+  }
+  if(!(job=calloc(1, sizeof(*job)))) {
+    perror("calloc");
+    return NULL;
+  }
+
+  created=1;
+  return job;
+}
+
+// Set 'option' (one of VANITY_*) of a job that is not started yet, with
+// argument 'arg' for options that take one. Returns 0 if the option or its
+// argument is invalid.
+//
+int vanity_set_option(struct vanity_job *job, int option, const char *arg)
+{
+  char *copy=NULL;
+
+  if(job->started || !option)
+    return 0;
+
+  /* Options with an argument keep their own copy of it */
+  if(strchr("CDMPRSTbcfgmnop", option)) {
+    if(!arg)
+      return 0;
+    if(!(copy=strdup(arg))) {
+      perror("strdup");
+      return 0;
+    }
+  }
+
+  switch(option) {
+  case VANITY_REBENCH:  /* Re-run hash kernel benchmark */
+    rebench=1;
+    break;
+  case VANITY_CHECKPOINT:  /* Seeded search with checkpoints */
+    options.checkpoint_path=copy;
+    break;
+  case VANITY_DAEMON:  /* Serve jobs on a unix socket */
+    options.daemon_path=copy;
+    break;
+  case VANITY_BSGS_MEMORY:  /* Baby-step table memory limit */
+    bsgs.memory=max(atoi(copy), 1);
+    break;
+  case VANITY_ORDERS:  /* Split-key orders */
+    options.orders_path=copy;
+    break;
+  case VANITY_RANGE:  /* Private key range scan */
+    options.range_arg=copy;
+    break;
+  case VANITY_COORDINATE:  /* Coordinate nodes */
+    options.coord_port=copy;
+    break;
+  case VANITY_BSGS_TABLE:  /* Baby-step table file */
+    bsgs.path=copy;
+    break;
+  case VANITY_BSGS:  /* Baby-step giant-step search for a public key */
+    options.bsgs_key=copy;
+    break;
+  case VANITY_COUNT:  /* Count */
+    max_count=max(atoi(copy), 1);
+    count_given=1;
+    break;
+  case VANITY_LIST:  /* Read list from file */
+    options.list_path=copy;
+    break;
+  case VANITY_GENERATE:  /* Bulk generation mode */
+    if(!strcmp(copy, "csv"))
+      gen_format=GEN_CSV;
+    else if(!strcmp(copy, "bin"))
+      gen_format=GEN_BIN;
+    else {
+      fprintf(stderr, "Error: Invalid output format '%s'.\n", copy);
+      return 0;
+    }
+    break;
+  case VANITY_ANYCASE:  /* Case-insensitive matches */
+    anycase=1;
+    break;
+  case VANITY_KEEP_GOING:  /* Keep going */
+    keep_going=1;
+    break;
+  case VANITY_MULTISIG:  /* 2-of-3 multisig cosigners */
+    options.keys=copy;
+    break;
+  case VANITY_TARGET:  /* Retire each prefix after a number of results */
+    target_count=max(atoi(copy), 1);
+    break;
+  case VANITY_OUTPUT:  /* Output file */
+    options.out_path=copy;
+    break;
+  case VANITY_SPLIT_KEY:  /* Split-key search from a customer public key */
+    options.split_key=copy;
+    break;
+  case VANITY_QUIET:  /* Quiet */
+    quiet=1;
+    verbose=0;
+    break;
+  case VANITY_NO_REKEY:  /* High hit-rate mode */
+    no_rekey=1;
+    break;
+  case VANITY_SUFFIX:  /* Match suffixes */
+    suffix_mode=1;
+    break;
+  case VANITY_VERBOSE:  /* Verbose */
+    quiet=0;
+    verbose=1;
+    break;
+  case VANITY_WORDS:  /* Match words anywhere */
+    word_mode=1;
+    break;
+  default:
+    return 0;
+  }
+
+  return 1;
+}
+
+// Add a prefix, suffix or word to search for to a job that is not started yet.
+// Returns 0 on error.
+//
+int vanity_add_pattern(struct vanity_job *job, const char *pattern)
+{
+  char *copy;
+
+  if(job->started)
+    return 0;
+  if(!(copy=strdup(pattern))) {
+    perror("strdup");
+    return 0;
+  }
+
+  return add_input(copy);
+}
+
+// Deliver each result of a job to 'callback', called with 'arg' from within
+// vanity_poll() and vanity_stop(), instead of queueing it.
+//
+void vanity_set_callback(struct vanity_job *job, vanity_callback callback,
+                         void *arg)
+{
+  job->callback=callback;
+  job->arg=arg;
+}
+
+// Compile the patterns of a job and fork off 'threads' workers (all CPUs if
+// 0). Returns 1 on success, 0 on error, or VANITY_USAGE if the patterns and
+// options don't make up a search.
+//
+int vanity_start(struct vanity_job *job, int threads)
+{
+  struct stat st;
+  int i, j, k, digits, parent_pid, procs;
+
+  if(job->started)
+    return 0;
+  if(threads < 1)
+    threads=get_num_cpus();
+
+  /* Select the fastest hash kernels for this host */
+  hash160_register(verbose, rebench);
+
+  if(suffix_mode && word_mode)
+    return VANITY_USAGE;
+  if(options.keys && !parse_cosigners(options.keys))
+    return 0;
+  if((options.split_key || options.orders_path) && gen_format) {
+    fprintf(stderr, "Error: -%c can't be used with -g.\n",
+            options.split_key ? 'p' : 'P');
+    return 0;
+  }
+
+  /* Bulk generation runs until stopped, unless given a count */
+  if(gen_format && !count_given)
+    keep_going=1;
+  if(options.split_key && !parse_split_key(options.split_key))
+    return 0;
+  if(options.checkpoint_path &&
+     !load_checkpoint(options.checkpoint_path, &threads))
+    return 0;
+  if(options.coord_port && (options.checkpoint_path || options.orders_path ||
+                            gen_format || options.bsgs_key)) {
+    fprintf(stderr, "Error: -S can't be used with -C, -P, -b or -g.\n");
+    return 0;
+  }
+  if(options.range_arg) {
+    if(options.checkpoint_path || options.orders_path || gen_format) {
+      fprintf(stderr, "Error: -R can't be used with -C, -P or -g.\n");
+      return 0;
+    }
+    if(!parse_range(options.range_arg))
+      return 0;
+  }
+
+  /* Baby-step giant-step searches have a key to find, not prefixes */
+  if(options.bsgs_key) {
+    if(!options.range_arg) {
+      fprintf(stderr, "Error: -b needs a range of keys given with -R.\n");
+      return 0;
+    }
+    if(num_inputs || options.list_path || options.keys ||
+       options.split_key || suffix_mode || word_mode) {
+      fprintf(stderr, "Error: -b can't be used with -f, -m, -p, -s, -w or "
+              "prefixes.\n");
+      return 0;
+    }
+    if(!parse_bsgs_key(options.bsgs_key))
+      return 0;
+  } else if(options.range_arg) {
+    /* Plain scans count the keys of the range in 64 bits */
+    if(range.span[0] || range.span[1] == ~0ULL) {
+      fprintf(stderr, "Error: -R ranges hold at most 2^64-1 keys, unless "
+              "searched with -b.\n");
+      return 0;
+    }
+    range.keys=range.span[1]+1;
+  }
+
+  /* Retiring prefixes as they are found only works for prefix searches */
+  if(target_count && (options.daemon_path || options.orders_path ||
+                      options.coord_port || options.bsgs_key || gen_format ||
+                      suffix_mode || word_mode)) {
+    fprintf(stderr, "Error: -n can't be used with -D, -P, -S, -b, -g, -s or "
+            "-w.\n");
+    return 0;
+  }
+
+  // Daemon jobs bring their own prefixes and options, which are compiled as
+  // they come.
+  if(options.daemon_path) {
+    if(num_inputs || options.list_path || options.keys || options.split_key ||
+       options.orders_path || options.checkpoint_path || options.range_arg ||
+       options.bsgs_key || options.coord_port || gen_format || anycase ||
+       keep_going || no_rekey || suffix_mode || word_mode) {
+      fprintf(stderr, "Error: -D takes its jobs from clients, and can only be "
+              "used with -B, -q and -v.\n");
+      return 0;
+    }
+    if(!serve_requests(options.daemon_path))
+      return 0;
+  }
+
+  // Orders bring their own prefixes, and the batch is split between them, so
+  // they only work with plain prefix searches.
+  if(options.orders_path) {
+    if(options.split_key || options.list_path || num_inputs || suffix_mode ||
+       word_mode) {
+      fprintf(stderr, "Error: -P can't be used with -p, -f, -s, -w or "
+              "prefixes on the command line.\n");
+      return 0;
+    }
+    if(!load_orders(options.orders_path))
+      return 0;
+  }
+
+  /* Add the list from the -f file to the patterns given */
+  if(options.list_path && !load_list(options.list_path))
+    return 0;
+  if(target_count && !init_targets())
+    return 0;
+
+  // A coordinator hands the options that affect matching to its nodes, then
+  // all prefixes, before compiling sorts some of them out of inputs[].
+  if(options.coord_port) {
+    /* At most 8 option arguments come before the prefixes */
+    if(!(job_args=malloc((num_inputs+8)*sizeof(char *)))) {
+      perror("malloc");
+      return 0;
+    }
+    if(anycase)
+      add_job_arg("-i");
+    if(no_rekey)
+      add_job_arg("-r");
+    if(suffix_mode)
+      add_job_arg("-s");
+    if(word_mode)
+      add_job_arg("-w");
+    if(options.keys) {
+      add_job_arg("-m");
+      add_job_arg(options.keys);
+    }
+    if(options.split_key) {
+      add_job_arg("-p");
+      add_job_arg(options.split_key);
+    }
+    for(i=0;i < num_inputs;i++)
+      add_job_arg(inputs[i]);
+  }
+
+  // Convert the list into a global list of public key byte patterns, suffixes
+  // into a table of numbers, or words into an automaton. Words are case folded
+  // by the automaton itself with -i, and so are prefixes, unless their
+  // patterns go into the tables of orders, daemon jobs or -n.
+  fold_mode=anycase && !options.orders_path && !options.daemon_path &&
+            !target_count;
+  if(word_mode || suffix_mode) {
+    for(i=0;i < num_inputs;i++)
+      if(word_mode ? !add_word(inputs[i]) :
+         (!anycase && !add_suffix(inputs[i])) ||
+         (anycase && !add_anycase(inputs[i], add_suffix)))
+        return 0;
+  } else if(num_orders) {
+    /* Compile each order's prefixes on its own; P2SH mode covers them all */
+    for(i=0;i < num_orders;i++)
+      for(j=0;j < orders[i].num_inputs;j++)
+        p2sh_mode |= (orders[i].inputs[j][0] == '3');
+    for(i=0;i < num_orders;i++) {
+      inputs=orders[i].inputs;
+      num_inputs=orders[i].num_inputs;
+      if(!compile_prefixes(threads, NULL))
+        return 0;
+      if(taproot_mode || eth_mode) {
+        fprintf(stderr, "Error: Orders can't have taproot or Ethereum "
+                "prefixes.\n");
+        return 0;
+      }
+      store_order(i);
+    }
+    load_order(0);
+  } else if(!bsgs_mode && daemon_fd == -1 &&
+            !compile_prefixes(threads, target_count ? NULL :
+                              options.list_path))
+    return 0;
+  if(!bsgs_mode && daemon_fd == -1 &&
+     !(num_patterns || num_bech32 || num_eth || num_suffixes || num_heads ||
+       num_words) == !gen_format)
+    return VANITY_USAGE;
+  if(multisig && !p2sh_mode) {
+    fprintf(stderr, "Error: Multisig addresses start with '3'.\n");
+    return 0;
+  }
+
+  // Prefixes retired with -n are recompiled into tables with room for as
+  // many again, for those added with SIGHUP.
+  if(target_count) {
+    if(eth_mode) {
+      fprintf(stderr, "Error: -n can't be used with Ethereum prefixes.\n");
+      return 0;
+    }
+    if(num_bech32 > TABLE_BECH32) {
+      fprintf(stderr, "Error: -n takes at most %d bech32 prefixes.\n",
+              TABLE_BECH32);
+      return 0;
+    }
+    table_size=max(table_size, 2*num_patterns);
+  }
+  compile_suffixes();
+  if(!compile_words())
+    return 0;
+
+  /* List patterns to match */
+  if(verbose) {
+    for(k=0;k < max(num_orders, 1);k++) {
+      if(num_orders) {
+        load_order(k);
+        fprintf(stderr, "O%d Customer key: %s\n", k+1, orders[k].pubkey);
+      }
+      for(digits=1,i=num_patterns;i > 9;i /= 10)
+        digits++;
+      for(i=0;i < num_patterns;i++) {
+        fprintf(stderr, "P%0*d High limit: ", digits, i+1);
+        for(j=0;j < 20;j++)
+          fprintf(stderr, "%02x", patterns[i].high[j]);
+        fprintf(stderr, "\nP%0*d Low limit:  ", digits, i+1);
+        for(j=0;j < 20;j++)
+          fprintf(stderr, "%02x", patterns[i].low[j]);
+        fprintf(stderr, "\n");
+      }
+      for(i=0;i < num_bech32;i++)
+        fprintf(stderr, "B%d Mask: %016llx Value: %016llx (%s%s)\n", i+1,
+                bech32_patterns[i].mask, bech32_patterns[i].value,
+                networks[bech32_patterns[i].network].name,
+                bech32_patterns[i].cashaddr ? " CashAddr" : "");
+    }
+    for(i=0;i < num_eth;i++)
+      fprintf(stderr, "E%d Mask: %016llx Value: %016llx%s\n", i+1,
+              eth_patterns[i].mask, eth_patterns[i].value,
+              eth_patterns[i].checksum ? " (EIP-55)" : "");
+    for(i=0;i < num_suffixes;i++)
+      fprintf(stderr, "S%d Suffix: %llu mod 58^%d\n", i+1, suffixes[i].value,
+              suffixes[i].len);
+    for(i=0;i < num_heads;i++)
+      fprintf(stderr, "H%d Head: %0*llx (%s)\n", i+1, (heads[i].len*3+1)/2,
+              heads[i].value, heads[i].prefix);
+    if(num_words)
+      fprintf(stderr, "%d words, %d automaton states\n", num_words,
+              num_word_states);
+    fprintf(stderr, "---\n");
+  }
+
+  difficulty=word_mode ? get_word_difficulty() :
+             suffix_mode ? get_suffix_difficulty() : get_difficulty();
+
+  /* Each order gets an equal share of every batch; follow the hardest one */
+  for(i=0;i < num_orders;i++) {
+    load_order(i);
+    difficulty=max(difficulty, get_difficulty()*num_orders);
+  }
+  if(difficulty < 1)
+    difficulty=1;
+
+  /* Load or build the baby-step table, before forking the workers */
+  if(bsgs_mode && !bsgs_prepare(threads))
+    return 0;
+
+  /* Set up the output stream for bulk generation mode */
+  if(gen_format) {
+    if(options.out_path) {
+      if((out_fd=open(options.out_path, O_WRONLY|O_CREAT|O_TRUNC|O_APPEND,
+                      0600)) == -1) {
+        perror(options.out_path);
+        return 0;
+      }
+    } else {
+      /* Keys go to standard output; don't mix in messages */
+      quiet=1;
+      verbose=0;
+      fcntl(out_fd, F_SETFL, fcntl(out_fd, F_GETFL)|O_APPEND);
+    }
+
+    // Writes of up to PIPE_BUF bytes are atomic on pipes, so workers sharing
+    // a pipe must flush in chunks of at most that size.
+    if(!fstat(out_fd, &st) && (S_ISFIFO(st.st_mode) || S_ISSOCK(st.st_mode)))
+      out_chunk=PIPE_BUF;
+  }
+
+  /* The relay takes the place of the workers, counting keys for each node */
+  if(options.coord_port) {
+    if(!serve_nodes(options.coord_port))
+      return 0;
+    threads=MAX_NODES;
+  }
+  procs=options.coord_port ? 1 : threads;
+
+  // Create memory-mapped area shared between all threads for reporting hash
+  // counts, plus the number of keys claimed in bulk generation mode and its
+  // error flag.
+  thread_count=mmap(NULL, (threads+2)*sizeof(u64), PROT_READ|PROT_WRITE,
+                    MAP_SHARED|MAP_ANONYMOUS|MAP_LOCKED, -1, 0);
+  if(thread_count == MAP_FAILED) {
+    perror("mmap");
+    return 0;
+  }
+  gen_issued=thread_count+threads;
+  gen_failed=gen_issued+1;
+
+  /* Resumed workers continue counting from their saved positions */
+  if(checkpoint.path)
+    for(i=0;i < threads;i++)
+      thread_count[i]=checkpoint.positions[i];
+
+  /* Range scan workers claim chunks from a shared counter */
+  if(range_mode) {
+    range.next_chunk=mmap(NULL, sizeof(u64), PROT_READ|PROT_WRITE,
+                          MAP_SHARED|MAP_ANONYMOUS, -1, 0);
+    if(range.next_chunk == MAP_FAILED) {
+      perror("mmap");
+      return 0;
+    }
+  }
+
+  // Daemon workers, and workers retiring prefixes with -n, match with the
+  // pattern tables published by the manager.
+  if(daemon_fd != -1 || target_count) {
+    for(i=0;i < 2;i++)
+      if((tables[i]=mmap(NULL, sizeof(struct table)+
+                         table_size*sizeof(struct pattern),
+                         PROT_READ|PROT_WRITE, MAP_SHARED|MAP_ANONYMOUS, -1,
+                         0)) == MAP_FAILED) {
+        perror("mmap");
+        return 0;
+      }
+    epochs=mmap(NULL, (threads+1)*sizeof(u32), PROT_READ|PROT_WRITE,
+                MAP_SHARED|MAP_ANONYMOUS, -1, 0);
+    if(epochs == MAP_FAILED) {
+      perror("mmap");
+      return 0;
+    }
+
+    /* No worker runs yet, so the first table is published without waiting */
+    if(target_count)
+      publish_table(job);
+  }
+
+  /* Workers skip orders that need no more results */
+  if(num_orders) {
+    orders_done=mmap(NULL, num_orders, PROT_READ|PROT_WRITE,
+                     MAP_SHARED|MAP_ANONYMOUS, -1, 0);
+    if(orders_done == MAP_FAILED) {
+      perror("mmap");
+      return 0;
+    }
+  }
+
+  /* In high hit-rate mode, results are queued through shared memory */
+  if(no_rekey) {
+    rings=mmap(NULL, threads*sizeof(*rings), PROT_READ|PROT_WRITE,
+               MAP_SHARED|MAP_ANONYMOUS, -1, 0);
+    if(rings == MAP_FAILED) {
+      perror("mmap");
+      return 0;
+    }
+  }
+
+  /* Create anonymous socket pair for children to send up solutions */
+  if(socketpair(AF_UNIX, SOCK_DGRAM, 0, sock)) {
+    perror("socketpair");
+    return 0;
+  }
+
+  /* Workers share the taproot tweak table copy-on-write */
+  if(taproot_mode && !taproot_prepare())
+    return 0;
+
+  /* Ignore signals */
+  signal(SIGPIPE, SIG_IGN);
+  signal(SIGCHLD, SIG_IGN);
+
+  /* Prefixes can be added to a -f list that is a file while searching */
+  if(target_count && options.list_path && strcmp(options.list_path, "-"))
+    signal(SIGHUP, reload_signal);
+
+  // Fork off the child processes. They leave with _exit(), so the buffered
+  // output of the calling process is never repeated.
+  parent_pid=getpid();
+  if(!(workers=calloc(procs, sizeof(pid_t)))) {
+    perror("calloc");
+    return 0;
+  }
+  for(i=0;i < procs;i++) {
+    if(!(workers[i]=fork())) {
+      /* In the child... */
+
+      /* Close the read end of the socketpair, and the daemon's socket */
+      close(sock[0]);
+      if(daemon_fd != -1)
+        close(daemon_fd);
+
+      /* Kill child process whenever parent process dies */
+      prctl(PR_SET_PDEATHSIG, SIGTERM);
+      if(getppid() != parent_pid)
+        _exit(0);  /* Parent process already died */
+
+      /* Run hashing engine, take giant steps, or relay for the nodes */
+      if(options.coord_port)
+        relay(threads);
+      else if(bsgs_mode)
+        bsgs_engine(i);
+      else
+        engine(i);
+      _exit(0);
+    }
+  }
+
+  /* Close the write end of the socketpair, and the relay's listening socket */
+  close(sock[1]);
+  if(listen_fd != -1)
+    close(listen_fd);
+
+  /* Resumed searches start from their saved counts */
+  job->threads=threads;
+  job->procs=procs;
+  job->found=checkpoint.found;
+  job->last_result=checkpoint.last_result;
+  for(i=0;i < threads;i++)
+    job->prev += thread_count[i];
+  job->next_checkpoint=time(NULL)+CHECKPOINT_INTERVAL;
+  job->started=1;
+  return 1;
+}
+
+// Wait up to a second for results from the workers, verify them and deliver
+// them. Once a second passes without any, update the key rate and check
+// whether the search is over. Stores the progress to 'stats' (if not NULL).
+// Returns 1 while the job runs, 0 once it has finished, or -1 on error.
+//
+int vanity_poll(struct vanity_job *job, struct vanity_stats *stats)
+{
+  fd_set readset;
+  struct timeval tv={1, 0};
+  u8 result[52];
+  u64 count, avg;
+  int i, ret, len, max_fd;
+
+  if(!job->started)
+    return -1;
+
+  /* Drop the queued results, once all of them have been read */
+  if(job->next_result == job->num_results)
+    job->num_results=job->next_result=0;
+  if(job->finished)
+    goto done;
+
+  /* Add the new prefixes of the -f list on SIGHUP */
+  if(reload_requested) {
+    reload_requested=0;
+    add_targets(job);
+  }
+
+  FD_ZERO(&readset);
+  FD_SET(sock[0], &readset);
+  if(coord_fd != -1)
+    FD_SET(coord_fd, &readset);
+  max_fd=max(sock[0], coord_fd);
+
+  /* Daemons also wait for new clients and the jobs they send */
+  if(daemon_fd != -1) {
+    FD_SET(daemon_fd, &readset);
+    max_fd=max(max_fd, daemon_fd);
+    for(i=0;i < MAX_REQUESTS;i++)
+      if(requests[i].fd != -1) {
+        FD_SET(requests[i].fd, &readset);
+        max_fd=max(max_fd, requests[i].fd);
+      }
+  }
+
+  if((ret=select(max_fd+1, &readset, NULL, NULL, &tv)) == -1) {
+    if(errno == EINTR)
+      goto done;
+    perror("select");
+    return -1;
+  }
+
+  /* Nodes stop when the coordinator says so, or goes away */
+  if(ret && coord_fd != -1 && FD_ISSET(coord_fd, &readset)) {
+    job->stopped=1;
+    end_search(job);
+    goto done;
+  }
+
+  if(ret) {
+    if(daemon_fd != -1) {
+      serve_clients(job, &readset);
+      if(!FD_ISSET(sock[0], &readset))
+        goto done;
+    }
+
+    /* Read the (PrivKey,PubKey) tuple from the socket */
+    if((len=read(sock[0], result, 52)) != 52) {
+      /* Something went very wrong if this happens */
+      if(len == -1) {
+        perror("read");
+        return -1;
+      }
+
+      /* Datagram read wasn't 52 bytes; could be a result ring doorbell */
+      if(rings)
+        drain_rings(job);
+      goto done;
+    }
+
+    /* Verify we received a valid (PrivKey,PubKey) tuple */
+    if(check_result(result))
+      announce_result(job, result);
+    if(targets)
+      retire_targets(job);
+    goto done;
+  }
+
+  // Pick up any results whose doorbell was absorbed by an earlier drain.
+  if(rings)
+    drain_rings(job);
+  if(targets)
+    retire_targets(job);
+  if(job->finished)
+    goto done;
+
+  /* Collect updated hash counts */
+  for(i=0,count=0;i < job->threads;i++)
+    count += thread_count[i];
+
+  /* Nodes report their key count to the coordinator */
+  if(coord_fd != -1)
+    dprintf(coord_fd, "COUNT %llu\n", count);
+
+  /* Save progress of seeded searches */
+  if(checkpoint.path && time(NULL) >= job->next_checkpoint) {
+    save_checkpoint(job->last_result, job->found);
+    job->next_checkpoint=time(NULL)+CHECKPOINT_INTERVAL;
+  }
+
+  // In bulk generation mode, or once the chunks of a range scan have all
+  // been claimed, the search is over when all workers have finished.
+  if((gen_format || range_mode) && waitpid(-1, NULL, WNOHANG) == -1 &&
+     errno == ECHILD) {
+    if(range_mode)
+      collect_results(job);
+
+    /* A failed write leaves the output incomplete */
+    if(gen_format && *gen_failed) {
+      job->finished=1;
+      return -1;
+    }
+
+    /* Nodes report their chunk as done, and may rejoin for another one */
+    if(coord_fd != -1) {
+      dprintf(coord_fd, "COUNT %llu\nDONE\n", count);
+      close(coord_fd);
+      coord_fd=-1;
+    }
+    job->finished=1;
+    goto done;
+  }
+
+  /* Average the last 8 seconds */
+  job->count_avg[job->count_index]=count-job->prev;
+  if(++job->count_index > job->count_max)
+    job->count_max=job->count_index;
+  if(job->count_index == NELEM(job->count_avg))
+    job->count_index=0;
+  job->prev=count;
+
+  for(i=0,avg=0;i < job->count_max;i++)
+    avg += job->count_avg[i];
+  job->rate=avg/job->count_max;
+
+  done:
+  if(stats)
+    vanity_get_stats(job, stats);
+  return job->failed ? -1 : !job->finished;
+}
+
+// Store the progress of a job to 'stats'.
+//
+void vanity_get_stats(struct vanity_job *job, struct vanity_stats *stats)
+{
+  u64 count;
+  int i;
+
+  for(i=0,count=0;i < job->threads;i++)
+    count += thread_count[i];
+
+  /* Range scans count all keys scanned rather than those since a result */
+  stats->keys=range_mode ? count : count-job->last_result;
+  stats->rate=job->rate;
+  stats->range_keys=range_mode ? range.keys : 0;
+  stats->difficulty=difficulty;
+  stats->found=job->found;
+  stats->wanted=keep_going ? 0 : targets ? num_targets*target_count :
+                max_count*max(num_orders, 1);
+  stats->finished=job->finished;
+  stats->stopped=job->stopped;
+}
+
+// Return the next queued result of a job without a callback, or NULL if there
+// is none. The result stays valid until the next call to vanity_poll().
+//
+const struct vanity_result *vanity_next_result(struct vanity_job *job)
+{
+  if(job->next_result == job->num_results)
+    return NULL;
+
+  return &job->results[job->next_result++];
+}
+
+// Stop the workers of a job and deliver the results they sent before
+// stopping. Seeded searches save a final checkpoint.
+//
+void vanity_stop(struct vanity_job *job)
+{
+  if(!job->started || job->finished)
+    return;
+
+  job->stopped=1;
+  stop_workers(job);
+  collect_results(job);
+  job->finished=1;
+
+  if(checkpoint.path)
+    save_checkpoint(job->last_result, job->found);
+}
+
+// Stop the workers of a job, if still running, and free it.
+//
+void vanity_free(struct vanity_job *job)
+{
+  if(job->started) {
+    stop_workers(job);
+    close(sock[0]);
+    if(coord_fd != -1)
+      close(coord_fd);
+
+    /* Daemons remove their socket; clients see their connections close */
+    if(daemon_fd != -1) {
+      close(daemon_fd);
+      unlink(options.daemon_path);
+    }
+  }
+
+  free(job->results);
+  free(job);
+}
+
+// Kill the worker processes of a job, and wait for them to exit.
+//
+static void stop_workers(struct vanity_job *job)
+{
+  int i;
+
+  for(i=0;i < job->procs;i++)
+    if(workers[i] > 0)
+      kill(workers[i], SIGTERM);
+
+  // Workers of a seeded search finish their batch first, and may be waiting
+  // for room to send its results. Those are taken in meanwhile: delivered
+  // while the job runs, or thrown away once it has finished.
+  for(i=0;checkpoint.path && i < job->procs;i++)
+    while(workers[i] > 0 && !waitpid(workers[i], NULL, WNOHANG)) {
+      if(job->finished)
+        discard_results(job);
+      else
+        collect_results(job);
+      usleep(1000);
+    }
+
+  /* Finished children are never zombies, so waiting ends with ECHILD */
+  for(i=0;i < job->procs;i++) {
+    if(workers[i] > 0)
+      while(waitpid(workers[i], NULL, 0) != -1 || errno == EINTR);
+    workers[i]=0;
+  }
+}
+
+// Stop the workers of a job that has found all it needs. Seeded searches
+// save a final checkpoint.
+//
+static void end_search(struct vanity_job *job)
+{
+  job->finished=1;
+  stop_workers(job);
+
+  if(checkpoint.path)
+    save_checkpoint(job->last_result, job->found);
+}
+
+// Throw away the results queued by the workers of a finished job.
+//
+static void discard_results(struct vanity_job *job)
+{
+  u8 result[52];
+  int i;
+
+  while(recv(sock[0], result, 52, MSG_DONTWAIT) != -1);
+  for(i=0;rings && i < job->threads;i++)
+    __atomic_store_n(&rings[i].tail,
+                     __atomic_load_n(&rings[i].head, __ATOMIC_ACQUIRE),
+                     __ATOMIC_RELEASE);
+}
+
+// Collect queued results from all worker rings, verify them in batches, and
+// announce the valid ones.
+//
+static void drain_rings(struct vanity_job *job)
+{
+  u8 batch[VERIFY_BATCH][52];
+  bool valid[VERIFY_BATCH];
+  u32 head, tail;
+  int i, j, n;
+
+  do {
+    /* Fill a batch from all rings */
+    for(i=n=0;i < job->threads && n < VERIFY_BATCH;i++) {
+      head=__atomic_load_n(&rings[i].head, __ATOMIC_ACQUIRE);
+      for(tail=rings[i].tail;tail != head && n < VERIFY_BATCH;tail++)
+        memcpy(batch[n++], rings[i].result[tail % RING_SIZE], 52);
+      __atomic_store_n(&rings[i].tail, tail, __ATOMIC_RELEASE);
+    }
+
+    /* Split-key orders are told apart by trying each public key */
+    if(!num_orders)
+      verify_keys((const u8 (*)[52])batch, valid, n);
+    for(j=0;j < n && !job->finished;j++)
+      if(num_orders ? find_order(batch[j]) >= 0 :
+         valid[j] && (!targets || wanted_key(batch[j])))
+        announce_result(job, batch[j]);
+  } while(n == VERIFY_BATCH && !job->finished);
+}
+
+// Announce the results still queued in the socket or the rings after the
+// workers have exited.
+//
+static void collect_results(struct vanity_job *job)
+{
+  u8 result[52];
+  int len;
+
+  while(!job->finished &&
+        (len=recv(sock[0], result, 52, MSG_DONTWAIT)) != -1)
+    if(len == 52 && check_result(result))
+      announce_result(job, result);
+  if(rings && !job->finished)
+    drain_rings(job);
+}
+
+// Returns 1 if the key in 'result' is valid and still wanted, making the order
+// or daemon job it is for the current one.
+//
+static bool check_result(const u8 result[52])
+{
+  if(num_orders)
+    return find_order(result) >= 0;
+  if(daemon_fd != -1)
+    return find_request(result) >= 0;
+
+  return verify_key(result) && (!targets || wanted_key(result));
+}
+
+// Deliver a verified result to the callback of the job, or queue it, with the
+// address and private key encoded for each network it matches. Ends the job
+// once it has found 'max_count' results.
+//
+static void announce_result(struct vanity_job *job, const u8 result[52])
+{
+  align8 u8 priv_block[64], cksum_block[64], checksum[32], pubkey[33];
+  struct vanity_result local, *r=&local;
+  char addresses[8][112], *key;
+  char hex[105];
+  int i, j, len, nets[8];
+
+  /* Reset hash count */
+  job->found++;
+  for(i=0,job->last_result=0;i < job->threads;i++)
+    job->last_result += thread_count[i];
+
+  /* Nodes send results up to the coordinator, which announces them */
+  if(coord_fd != -1) {
+    for(j=0;j < 52;j++)
+      sprintf(hex+j*2, "%02x", result[j]);
+    dprintf(coord_fd, "RESULT %s\n", hex);
+    return;
+  }
+
+  /* Without a callback, results are queued for vanity_next_result() */
+  if(!job->callback && daemon_fd == -1) {
+    /* Resize the array every 100 elements */
+    if(!(job->num_results % 100)) {
+      if(!(r=realloc(job->results, (job->num_results+100)*sizeof(*r)))) {
+        perror("realloc");
+        job->failed=1;
+        return;
+      }
+      job->results=r;
+    }
+    r=&job->results[job->num_results++];
+  }
+
+  memset(r, 0, sizeof(*r));
+  r->found=daemon_fd == -1 ? job->found : ++requests[current_request].found;
+  r->partial=split_mode;
+  memcpy(r->privkey, result, 32);
+  memcpy(r->hash, result+32, 20);
+
+  /* Set up checksum block; length of 32 bytes */
+  sha256_prepare(cksum_block, 32);
+
+  /* The same key may match the prefixes of several networks */
+  r->num_addresses=get_addresses(result, nets, addresses);
+
+  for(i=0;i < r->num_addresses;i++) {
+    strcpy(r->addresses[i].address, addresses[i]);
+    key=r->addresses[i].key;
+
+    /* Name the network only when other than Bitcoin ones are searched */
+    if(used_networks & ~1)
+      r->addresses[i].network=networks[nets[i]].name;
+
+    /* Ethereum private keys and split-key partial keys are shown in hex */
+    if(eth_mode || split_mode) {
+      len=eth_mode ? sprintf(key, "0x") : 0;
+      for(j=0;j < 32;j++)
+        len += sprintf(key+len, "%02x", result[j]);
+    } else {
+      /* Convert Private Key to WIF */
+
+      /* Set up sha256 block for hashing the private key; length of 34 bytes */
+      sha256_prepare(priv_block, 34);
+      priv_block[0]=networks[nets[i]].wif;
+      memcpy(priv_block+1, result, 32);
+      priv_block[33]=0x01;  /* 1=Compressed Public Key */
+
+      /* Compute checksum and copy first 4-bytes to end of private key */
+      sha256_hash(cksum_block, priv_block);
+      sha256_hash(checksum, cksum_block);
+      memcpy(priv_block+34, checksum, 4);
+
+      b58enc_wif(key, priv_block);
+    }
+  }
+
+  /* Name the order's customer key */
+  if(num_orders)
+    r->customer_key=orders[current_order].pubkey;
+
+  /* The redeem script needed to spend from a multisig address */
+  if(multisig) {
+    get_pubkey(pubkey, result);
+    len=sprintf(r->redeem_script, "5221");
+    for(j=0;j < 33;j++)
+      len += sprintf(r->redeem_script+len, "%02x", cosigners[0][j]);
+    len += sprintf(r->redeem_script+len, "21");
+    for(j=0;j < 33;j++)
+      len += sprintf(r->redeem_script+len, "%02x", cosigners[1][j]);
+    len += sprintf(r->redeem_script+len, "21");
+    for(j=0;j < 33;j++)
+      len += sprintf(r->redeem_script+len, "%02x", pubkey[j]);
+    sprintf(r->redeem_script+len, "53ae");
+  }
+
+  /* Report which word was found in the address */
+  if(num_words && (j=match_word(addresses[0])) >= 0)
+    r->word=words[j];
+
+  /* Finish after 'max_count' solutions, for each order with -P */
+  if(num_orders && !keep_going &&
+     ++orders[current_order].found >= max_count) {
+    orders_done[current_order]=1;
+    for(i=0;i < num_orders && orders_done[i];i++);
+    r->last=(i == num_orders);
+  } else if(!num_orders && !targets && !keep_going && r->found >= max_count)
+    r->last=1;
+
+  /* With -n, credit the prefixes matched; finish once all have retired */
+  if(targets && match_targets(addresses, r->num_addresses, 1) &&
+     !keep_going && !targets_left)
+    r->last=1;
+
+  /* Daemons send results to the client of the job, then go on to the next */
+  if(daemon_fd != -1) {
+    for(i=0;i < r->num_addresses;i++)
+      dprintf(requests[current_request].fd, "RESULT\t%d\t%s\t%s\t%s\n",
+              r->found, r->addresses[i].address, r->addresses[i].key,
+              networks[nets[i]].name);
+    if(r->last)
+      end_request(job, current_request, 1);
+    return;
+  }
+
+  if(job->callback)
+    job->callback(r, job->arg);
+  if(r->last)
+    end_search(job);
+}
+
+// Find the addresses of the key in 'result' that start with a wanted prefix,
+// storing them to 'addresses' and the indexes of their networks in networks[]
+// to 'nets'. Returns the number of addresses found (at most 8); keys found by
+// suffix or word have just their Bitcoin address.
+//
+static int get_addresses(const u8 result[52], int *nets,
+                         char (*addresses)[112])
+{
+  align8 u8 pub_block[64], cksum_block[64], checksum[32], hash[20];
+  u8 pubkey[33], xonly[32];
+  u64 key=be64(*(const u64 *)(result+32));
+  const struct network *net;
+  int i, j, n=0;
+
+  /* Ethereum and taproot addresses have a single encoding */
+  nets[0]=0;
+  if(eth_mode) {
+    eth_encode(addresses[0], result+32);
+    return 1;
+  } else if(taproot_mode) {
+    get_taproot_key(xonly, result);
+    segwit_encode(addresses[0], "bc", 1, xonly, 32);
+    return 1;
+  }
+
+  /* Bech32 and CashAddr prefixes are tagged with their network */
+  for(i=0;i < num_bech32;i++) {
+    if((key & bech32_patterns[i].mask) != bech32_patterns[i].value)
+      continue;
+    net=&networks[nets[n]=bech32_patterns[i].network];
+    if(bech32_patterns[i].cashaddr)
+      cashaddr_encode(addresses[n], net->cashaddr, 0, result+32, 20);
+    else
+      segwit_encode(addresses[n], net->hrp, 0, result+32, 20);
+
+    /* Skip addresses already found through another prefix */
+    for(j=0;j < n && strcmp(addresses[j], addresses[n]);j++);
+    n += (j == n);
+  }
+
+  /* P2SH matches use the script hash, with version byte 0x05 */
+  if(multisig) {
+    get_pubkey(pubkey, result);
+    hash160_multisig_many(hash, pubkey, 1, multisig);
+  } else if(p2sh_mode)
+    hash160_p2wpkh_many(hash, result+32, 1);
+  else
+    memcpy(hash, result+32, 20);
+
+  /* Set up checksum block; length of 32 bytes */
+  sha256_prepare(cksum_block, 32);
+
+  // Base58 prefixes of all networks share one set of patterns, so with more
+  // than one network, each encoding is checked against the prefixes given.
+  if((num_patterns && match_prefix(hash)) || (num_heads && match_head(hash))) {
+    for(i=0;i < NELEM(networks);i++) {
+      if(!(base58_networks & 1 << i))
+        continue;
+
+      /* Set up sha256 block for hashing the public key; length of 21 bytes */
+      sha256_prepare(pub_block, 21);
+      pub_block[0]=p2sh_mode ? 0x05 : networks[i].version;
+      memcpy(pub_block+1, hash, 20);
+
+      /* Compute checksum and copy first 4-bytes to end of public key */
+      sha256_hash(cksum_block, pub_block);
+      sha256_hash(checksum, cksum_block);
+      memcpy(pub_block+21, checksum, 4);
+
+      b58enc_addr(addresses[n], pub_block);
+      if(__builtin_popcount(base58_networks) == 1 ||
+         match_input(addresses[n]))
+        nets[n++]=i;
+    }
+  }
+
+  /* Suffixes and words are searched in Bitcoin addresses */
+  if(!n) {
+    nets[0]=0;
+    sha256_prepare(pub_block, 21);
+    pub_block[0]=0x00;
+    memcpy(pub_block+1, hash, 20);
+    sha256_hash(cksum_block, pub_block);
+    sha256_hash(checksum, cksum_block);
+    memcpy(pub_block+21, checksum, 4);
+    b58enc_addr(addresses[n++], pub_block);
+  }
+
+  return n;
+}
+
+// Returns 1 if 'address' starts with any of the Base58 prefixes in inputs[].
+//
+static bool match_input(const char *address)
+{
+  int i;
+
+  for(i=0;i < num_inputs;i++)
+    if(!(anycase ? strncasecmp : strncmp)(address, inputs[i],
+                                          strlen(inputs[i])))
+      return 1;
+
+  return 0;
+}
+
+
+/**** Pattern Matching *******************************************************/
+
+// Parse the customer public key given with -p.
+//
+static bool parse_split_key(const char *arg)
+{
+  if(!parse_pubkey(&split_base, arg)) {
+    fprintf(stderr, "Error: -p needs a public key in hex.\n");
+    return 0;
+  }
+
+  split_mode=1;
+  return 1;
+}
+
+// Parse a compressed or uncompressed public key in hex into 'ge'. Returns 0 if
+// it is not a valid point.
+//
+static bool parse_pubkey(secp256k1_ge *ge, const char *arg)
+{
+  u8 pubkey[65];
+  int i, len=strlen(arg)/2;
+
+  if((len != 33 && len != 65) || strspn(arg, "0123456789abcdefABCDEF") !=
+     len*2 || arg[len*2])
+    return 0;
+  for(i=0;i < len;i++,arg += 2)
+    sscanf(arg, "%2hhx", &pubkey[i]);
+
+  return secp256k1_eckey_pubkey_parse(ge, pubkey, len);
+}
+
+// Parse the two cosigner public keys given with -m as "hex1,hex2", and set up
+// the multisig script hashing.
+//
+static bool parse_cosigners(const char *arg)
+{
+  static struct multisig ms;
+  secp256k1_ge ge;
+  int i, j;
+
+  for(i=0;i < 2;i++) {
+    if(strspn(arg, "0123456789abcdefABCDEF") != 66 || arg[66] != ",\0"[i])
+      goto error;
+    for(j=0;j < 33;j++,arg += 2)
+      sscanf(arg, "%2hhx", &cosigners[i][j]);
+    arg++;
+
+    if(!secp256k1_eckey_pubkey_parse(&ge, cosigners[i], 33))
+      goto error;
+  }
+
+  multisig_prepare(&ms, (const u8 (*)[33])cosigners);
+  multisig=&ms;
+  return 1;
+
+  error:
+  fprintf(stderr, "Error: -m needs two compressed public keys in hex, "
+          "separated by a comma.\n");
+  return 0;
+}
+
+// Add an input string to the inputs[] list, taking a copy made by strdup()
+// (NULL if that failed). Returns 0 if out of memory.
+//
+static bool add_input(char *str)
+{
+  char **list;
+
+  if(!str) {
+    perror("strdup");
+    return 0;
+  }
+
+  /* Resize the array every 1024 elements */
+  if(!(num_inputs % 1024)) {
+    if(!(list=realloc(inputs, (num_inputs+1024)*sizeof(char *)))) {
+      perror("realloc");
+      free(str);
+      return 0;
+    }
+    inputs=list;
+  }
+
+  inputs[num_inputs++]=str;
+  return 1;
+}
+
+// Read a list of prefixes, suffixes or words from 'path' ("-" for standard
+// input), one per line. Blank lines and lines starting with '#' are skipped.
+//
+static bool load_list(const char *path)
+{
+  FILE *fp=stdin;
+  char *line=NULL;
+  size_t size=0;
+  ssize_t len;
+
+  if(strcmp(path, "-") && !(fp=fopen(path, "r"))) {
+    perror(path);
+    return 0;
+  }
+
+  while((len=getline(&line, &size, fp)) != -1) {
+    while(len && strchr(" \t\r\n", line[len-1]))
+      line[--len]='\0';
+    if(len && line[0] != '#' && !add_input(strdup(line)))
+      break;
+  }
+
+  free(line);
+  if(fp != stdin)
+    fclose(fp);
+  return len == -1;
+}
+
+// Make room for at least 'n' patterns in the patterns[] array. Returns 0 if
+// out of memory.
+//
+static bool reserve_patterns(int n)
+{
+  void *list;
+  int size;
+
+  if(n <= max_patterns)
+    return 1;
+
+  size=max(n, 2*max_patterns);
+  if(!(list=realloc(patterns, size*sizeof(*patterns)))) {
+    perror("realloc");
+    return 0;
+  }
+
+  patterns=list;
+  max_patterns=size;
+  return 1;
+}
+
+// Add a low/high pattern range to the patterns[] array. Overlapping ranges are
+// merged later by compile_patterns(). Returns 0 if out of memory.
+//
+static bool add_pattern(void *low, void *high)
+{
+  if(!reserve_patterns(num_patterns+1))
+    return 0;
+
+  memcpy(patterns[num_patterns].low, low, 20);
+  memcpy(patterns[num_patterns].high, high, 20);
+  num_patterns++;
+  return 1;
+}
+
+static int pattern_cmp(const void *a, const void *b)
+{
+  return memcmp(((const typeof(*patterns) *)a)->low,
+                ((const typeof(*patterns) *)b)->low, 20);
+}
+
+// Sort the patterns[] array by low limit and coalesce adjacent or overlapping
+// ranges in one pass, leaving a sorted list of disjoint ranges. Returns 0 if
+// out of memory.
+//
+static bool compile_patterns()
+{
+  u8 next[20];
+  int i, j, n=0;
+
+  qsort(patterns, num_patterns, sizeof(*patterns), pattern_cmp);
+
+  for(i=0;i < num_patterns;i++) {
+    if(n) {
+      /* next = high+1 of the last range, which may wrap around to zero */
+      memcpy(next, patterns[n-1].high, 20);
+      for(j=19;j >= 0 && !++next[j];j--);
+
+      if(j < 0 || memcmp(patterns[i].low, next, 20) <= 0) {
+        if(memcmp(patterns[i].high, patterns[n-1].high, 20) > 0)
+          memcpy(patterns[n-1].high, patterns[i].high, 20);
+        continue;
+      }
+    }
+    patterns[n++]=patterns[i];
+  }
+
+  num_patterns=n;
+
+  /* Fill in the prefilter buckets */
+  if(!pattern_buckets &&
+     !(pattern_buckets=malloc((NUM_BUCKETS+1)*sizeof(u32)))) {
+    perror("malloc");
+    return 0;
+  }
+  for(i=0,j=0;j <= NUM_BUCKETS;j++) {
+    while(i < num_patterns &&
+          (patterns[i].low[0] << 8 | patterns[i].low[1]) < j)
+      i++;
+    pattern_buckets[j]=i;
+  }
+
+  return 1;
+}
+
+// Compile the prefixes in inputs[] into patterns, bech32 or Ethereum masks.
+// Prefix lists from the file 'list_path' (or NULL) use the pattern index
+// cache. Returns 0 on error.
+//
+static bool compile_prefixes(int threads, const char *list_path)
+{
+  u64 key;
+  int i, j, k, encoding;
+
+  // Taproot (bc1p) and Ethereum (0x) prefixes match tweaked output keys
+  // and Keccak hashes rather than public key hashes, so they can't be mixed
+  // with other address types.
+  for(i=0;i < num_inputs;i++) {
+    taproot_mode |= !strncasecmp(inputs[i], "bc1p", 4);
+    eth_mode |= !strncmp(inputs[i], "0x", 2);
+  }
+
+  // Bech32 and CashAddr prefixes are compiled separately from Base58
+  // prefixes. Those of all networks share one index, as they all match the
+  // same hashed public key.
+  for(i=j=0;i < num_inputs;i++) {
+    if((taproot_mode && strncasecmp(inputs[i], "bc1p", 4)) ||
+       (eth_mode && strncmp(inputs[i], "0x", 2))) {
+      fprintf(stderr, "Error: %s prefixes can't be mixed with other "
+              "address types.\n", eth_mode ? "Ethereum" : "Taproot");
+      return 0;
+    }
+    if(eth_mode) {
+      if(!add_eth_prefix(inputs[i]))
+        return 0;
+      continue;
+    }
+    if((k=get_network(inputs[i], &encoding)) < 0) {
+      k=0;  /* Reported by add_prefix() */
+      encoding=ENC_BASE58;
+    }
+    used_networks |= 1 << k;
+    if(encoding == ENC_BASE58) {
+      base58_networks |= 1 << k;
+      inputs[j++]=inputs[i];
+    } else if(encoding == ENC_BECH32 ? !add_bech32_prefix(inputs[i]) :
+              !add_cashaddr_prefix(inputs[i]))
+      return 0;
+  }
+  num_inputs=j;
+  compile_bech32();
+
+  /* Prefixes starting with '3' are matched on P2SH-P2WPKH script hashes */
+  for(i=0;i < num_inputs;i++)
+    p2sh_mode |= (inputs[i][0] == '3');
+
+  /* Case-insensitive prefixes are matched by their heads */
+  if(fold_mode) {
+    for(i=0;i < num_inputs;i++)
+      if(!add_head(inputs[i]))
+        return 0;
+    compile_heads();
+    return 1;
+  }
+
+  /* Lists from a file use the pattern index cache */
+  key=list_path ? index_key() : 0;
+  if(num_inputs && (!list_path || !load_index(key))) {
+    if(!build_patterns(threads))
+      return 0;
+    if(list_path)
+      save_index(key);
+  }
+
+  return 1;
+}
+
+// Read split-key orders from 'path' ("-" for standard input), one per line as
+// a customer public key in hex followed by its prefixes.
+//
+static bool load_orders(const char *path)
+{
+  FILE *fp=stdin;
+  char *line=NULL, *word, *save;
+  struct order *order;
+  size_t size=0;
+  int num=0;
+
+  if(strcmp(path, "-") && !(fp=fopen(path, "r"))) {
+    perror(path);
+    return 0;
+  }
+
+  while(getline(&line, &size, fp) != -1) {
+    num++;
+    if(!(word=strtok_r(line, " \t\r\n", &save)) || word[0] == '#')
+      continue;
+
+    /* Resize the array every 100 elements */
+    if(!(num_orders % 100)) {
+      if(!(order=realloc(orders, (num_orders+100)*sizeof(*orders)))) {
+        perror("realloc");
+        return 0;
+      }
+      orders=order;
+    }
+
+    order=&orders[num_orders];
+    memset(order, 0, sizeof(*order));
+    if(!parse_pubkey(&order->base, word)) {
+      fprintf(stderr, "Error: %s:%d: Invalid public key '%s'.\n", path, num,
+              word);
+      return 0;
+    }
+    if(!(order->pubkey=strdup(word))) {
+      perror("strdup");
+      return 0;
+    }
+
+    /* The rest of the line is this order's prefixes */
+    inputs=NULL;
+    num_inputs=0;
+    while((word=strtok_r(NULL, " \t\r\n", &save)))
+      if(!add_input(strdup(word)))
+        return 0;
+    if(!num_inputs) {
+      fprintf(stderr, "Error: %s:%d: No prefixes given.\n", path, num);
+      return 0;
+    }
+    order->inputs=inputs;
+    order->num_inputs=num_inputs;
+
+    /* The batch is split into segments of at least 32 keys */
+    if(++num_orders > STEP/32) {
+      fprintf(stderr, "Error: Too many orders (at most %d).\n", STEP/32);
+      return 0;
+    }
+  }
+
+  free(line);
+  if(fp != stdin)
+    fclose(fp);
+
+  inputs=NULL;
+  num_inputs=0;
+  if(!num_orders) {
+    fprintf(stderr, "Error: No orders in %s.\n", path);
+    return 0;
+  }
+
+  split_mode=1;
+  return 1;
+}
+
+// Make order 'n' the current one: its public key and patterns are used for
+// matching and reporting.
+//
+static void load_order(int n)
+{
+  struct order *order=&orders[n];
+
+  split_base=order->base;
+  inputs=order->inputs;
+  num_inputs=order->num_inputs;
+  patterns=order->patterns;
+  pattern_buckets=order->pattern_buckets;
+  num_patterns=max_patterns=order->num_patterns;
+  bech32_patterns=order->bech32_patterns;
+  num_bech32=order->num_bech32;
+  current_order=n;
+}
+
+// Save the compiled patterns into order 'n', and clear them for the next one.
+//
+static void store_order(int n)
+{
+  struct order *order=&orders[n];
+
+  order->inputs=inputs;
+  order->num_inputs=num_inputs;
+  order->patterns=patterns;
+  order->pattern_buckets=pattern_buckets;
+  order->num_patterns=num_patterns;
+  order->bech32_patterns=bech32_patterns;
+  order->num_bech32=num_bech32;
+
+  patterns=NULL;
+  pattern_buckets=NULL;
+  num_patterns=max_patterns=0;
+  bech32_patterns=NULL;
+  num_bech32=0;
+}
+
+// Find the order whose public key, plus the partial key in 'result', hashes
+// to the public key hash in 'result', and make it the current order. Returns
+// its index, or -1 if there is none or it needs no more results.
+//
+static int find_order(const u8 result[52])
+{
+  int i;
+
+  for(i=0;i < num_orders;i++) {
+    load_order(i);
+    if(verify_key(result))
+      return orders_done[i] ? -1 : i;
+  }
+
+  return -1;
+}
+
+// Convert a range of inputs[] to patterns with add_prefix() or
+// add_anycase_prefix().
+//
+static bool add_prefixes(int start, int end)
+{
+  for(;start < end;start++)
+    if((!anycase && !add_prefix(inputs[start])) ||
+       (anycase && !add_anycase_prefix(inputs[start])))
+      return 0;
+
+  return 1;
+}
+
+// Convert all inputs to byte patterns, then sort and merge them. Long lists
+// are split over 'threads' child processes, which send their unmerged
+// patterns back through pipes.
+//
+static bool build_patterns(int threads)
+{
+  int i, fd[2], status, pids[threads], fds[threads];
+  size_t bytes=0;
+  ssize_t len;
+  bool ok=1;
+
+  threads=min(threads, num_inputs/PARALLEL_MIN);
+  if(threads < 2)
+    return add_prefixes(0, num_inputs) && compile_patterns();
+
+  for(i=0;i < threads;i++) {
+    if(pipe(fd)) {
+      perror("pipe");
+      break;
+    }
+    if((pids[i]=fork()) == -1) {
+      perror("fork");
+      close(fd[0]);
+      close(fd[1]);
+      break;
+    }
+
+    if(!pids[i]) {
+      close(fd[0]);
+      if(!add_prefixes((u64)num_inputs*i/threads,
+                       (u64)num_inputs*(i+1)/threads))
+        _exit(1);
+
+      /* Send patterns to the parent */
+      for(;bytes < num_patterns*sizeof(*patterns);bytes += len)
+        if((len=write(fd[1], (u8 *)patterns+bytes,
+                      num_patterns*sizeof(*patterns)-bytes)) <= 0)
+          _exit(1);
+      _exit(0);
+    }
+
+    close(fd[1]);
+    fds[i]=fd[0];
+  }
+
+  /* Collect patterns in order from the children started */
+  if(i < threads) {
+    threads=i;
+    ok=0;
+  }
+  for(i=0;i < threads;i++) {
+    do {
+      if(!reserve_patterns(num_patterns+PARALLEL_MIN)) {
+        ok=0;
+        break;
+      }
+      len=read(fds[i], (u8 *)patterns+bytes,
+               max_patterns*sizeof(*patterns)-bytes);
+      if(len > 0)
+        num_patterns=(bytes += len)/sizeof(*patterns);
+    } while(len > 0 || (len == -1 && errno == EINTR));
+
+    close(fds[i]);
+    if(waitpid(pids[i], &status, 0) == -1 || !WIFEXITED(status) ||
+       WEXITSTATUS(status))
+      ok=0;
+  }
+
+  return ok && compile_patterns();
+}
+
+// Return a 64-bit FNV-1a hash of the input list and the options that affect
+// pattern compilation, identifying its pattern index file.
+//
+static u64 index_key()
+{
+  u64 hash=0xcbf29ce484222325;
+  const char *str;
+  int i;
+
+  hash=(hash ^ (INDEX_VERSION << 1 | anycase))*0x100000001b3;
+  for(i=0;i < num_inputs;i++) {
+    for(str=inputs[i];*str;str++)
+      hash=(hash ^ (u8)*str)*0x100000001b3;
+    hash=(hash ^ '\n')*0x100000001b3;
+  }
+
+  return hash;
+}
+
+// Store the path of the pattern index file for 'key' in 'path', creating the
+// cache directory if needed.
+//
+static void index_path(char path[1024], u64 key)
+{
+  char *home=getenv("HOME");
+
+  snprintf(path, 1024, "%s/.cache", home ?: ".");
+  mkdir(path, 0755);
+  snprintf(path, 1024, "%s/" INDEX_DIR, home ?: ".");
+  mkdir(path, 0755);
+  snprintf(path, 1024, "%s/" INDEX_DIR "/%016llx.idx", home ?: ".", key);
+}
+
+// Map a previously saved pattern index for 'key' read-only, in place of
+// compiling the patterns. The mapping is inherited by the worker processes,
+// and the page cache shares it between instances. Returns 0 if there is no
+// valid index file.
+//
+static bool load_index(u64 key)
+{
+  const struct index_header *header;
+  char path[1024];
+  struct stat st;
+  u8 *map;
+  int fd;
+
+  index_path(path, key);
+  if((fd=open(path, O_RDONLY)) == -1)
+    return 0;
+
+  if(fstat(fd, &st) || st.st_size < INDEX_PATTERNS ||
+     (map=mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE|MAP_POPULATE, fd,
+               0)) == MAP_FAILED) {
+    close(fd);
+    return 0;
+  }
+  close(fd);
+
+  /* Validate header */
+  header=(const struct index_header *)map;
+  if(memcmp(header->magic, INDEX_MAGIC, 8) ||
+     header->version != INDEX_VERSION || header->key != key ||
+     header->size != st.st_size || header->size != INDEX_PATTERNS+
+     (u64)header->num_patterns*sizeof(*patterns)) {
+    munmap(map, st.st_size);
+    return 0;
+  }
+
+  pattern_buckets=(u32 *)(map+INDEX_BUCKETS);
+  patterns=(void *)(map+INDEX_PATTERNS);
+  num_patterns=max_patterns=header->num_patterns;
+
+  if(verbose)
+    fprintf(stderr, "Loaded pattern index %s\n", path);
+  return 1;
+}
+
+// Save the compiled patterns and buckets as the pattern index for 'key'. The
+// file is written under a temporary name and renamed into place, so other
+// instances never see a partial index. Failure to save is not an error.
+//
+static void save_index(u64 key)
+{
+  struct index_header header={INDEX_MAGIC, INDEX_VERSION};
+  static const u8 zero[INDEX_PATTERNS];
+  char path[1024], temp[1100];
+  FILE *fp;
+  bool ok;
+
+  header.num_patterns=num_patterns;
+  header.key=key;
+  header.size=INDEX_PATTERNS+(u64)num_patterns*sizeof(*patterns);
+
+  index_path(path, key);
+  snprintf(temp, sizeof(temp), "%s.%d", path, getpid());
+  if(!(fp=fopen(temp, "w")))
+    return;
+
+  ok=(fwrite(&header, sizeof(header), 1, fp) == 1 &&
+      fwrite(zero, INDEX_BUCKETS-sizeof(header), 1, fp) == 1 &&
+      fwrite(pattern_buckets, (NUM_BUCKETS+1)*sizeof(u32), 1, fp) == 1 &&
+      fwrite(zero, INDEX_PATTERNS-INDEX_BUCKETS-(NUM_BUCKETS+1)*sizeof(u32),
+             1, fp) == 1 &&
+      fwrite(patterns, sizeof(*patterns), num_patterns, fp) == num_patterns);
+
+  if(fclose(fp) || !ok || rename(temp, path))
+    unlink(temp);
+  else if(verbose)
+    fprintf(stderr, "Saved pattern index %s\n", path);
+}
+
+// Convert an address prefix to one or more 20-byte patterns to match on the
+// binary level.
+//
+static bool add_prefix(const char *prefix)
+{
+  /* Determine range of matching public keys */
+  size_t pattern_sz=25;
+  size_t b58sz=strlen(prefix);
+  u8 pattern1[32], pattern2[32];
+  char pat1[64], pat2[64], test[64];
+  int i, j, nonzero, ones, offset=0, plen=strlen(prefix);
+  bool lt, valid;
+
+  /* Validate prefix; other networks' prefixes have a fixed version byte */
+  if(prefix[0] == '3')
+    return add_version_prefix(prefix, 0x05, "P2SH");
+  if(prefix[0] != '1' && (get_network(prefix, &i) < 0 || i != ENC_BASE58)) {
+    if(anycase)
+      return 1;
+    fprintf(stderr, "Error: Unknown address prefix '%s'.\n", prefix);
+    return 0;
+  } if(p2sh_mode) {
+    fprintf(stderr, "Error: Can't mix '%c' and '3' prefixes.\n", prefix[0]);
+    return 0;
+  } if(prefix[0] != '1') {
+    i=get_network(prefix, &j);
+    return add_version_prefix(prefix, networks[i].version, networks[i].name);
+  } if(plen > 28) {
+    fprintf(stderr, "Error: Prefix too long.\n");
+    return 0;
+  } if(!b58tobin(pattern1, &pattern_sz, prefix, b58sz)) {
+    fprintf(stderr, "Error: Address '%s' contains an invalid character.\n",
+            prefix);
+    return 0;
+  }
+
+  /* Special case when prefix is all 1's */
+  for(i=0;prefix[i] == '1';i++);
+  if(!prefix[i]) {
+    memset(pattern1+1, 0, 24);
+    pattern2[0]=0;
+    memset(pattern2+1, 0xff, 24);
+    for(j=1;j < 25;j++) {
+      b58enc_addr(test, pattern2);
+      if(!strncmp(test, prefix, plen))
+        break;
+      pattern2[j]=0;
+    }
+    return add_pattern(pattern1+1, pattern2+1);
+  }
+
+  // Pad the prefix to a full address and prepend more 1's until the low limit
+  // encodes back to the prefix, which is when its number of leading zero
+  // bytes equals the number of leading 1's in the prefix ('ones').
+  ones=i;
+  do {
+    strcpy(pat1+offset, prefix);
+    strcpy(pat2+offset, prefix);
+    lt=(strcmp(pat1, "1QLbz7JHiBTspS962RLKV8GndWFw") < 0);
+    for(i=strlen(pat1);i < (lt?34:33);i++) {
+      pat1[i]='1';
+      pat2[i]='z';
+    }
+    pat1[i]='\0';
+    pat2[i]='\0';
+
+    b58sz=i;
+    pattern_sz=25;
+    valid=b58tobin(pattern1, &pattern_sz, pat1, b58sz);
+    for(j=0;j < 25 && !pattern1[j];j++);
+
+    offset++;
+  } while(offset < 28 && (!valid || j != ones));
+
+  b58sz=i;
+  pattern_sz=25;
+  b58tobin(pattern2, &pattern_sz, pat2, b58sz);
+
+#if 0
+  fprintf(stderr, "X Low limit:   ");
+  for(j=0;j < 20;j++)
+    fprintf(stderr, "%02x", pattern1[j+1]);
+  fprintf(stderr, "\nX High limit:  ");
+  for(j=0;j < 20;j++)
+    fprintf(stderr, "%02x", pattern2[j+1]);
+  fprintf(stderr, "\n");
+#endif
+
+  /* Search for the first nonzero byte in either pattern */
+  for(i=0;i < 25 && !(pattern1[i] | pattern2[i]);i++);
+  nonzero=i;
+  if(pattern1[nonzero]) {
+    if(!add_pattern(pattern1+1, pattern2+1))
+      return 0;
+  } else {
+    pattern2[nonzero]=0;
+    memset(pattern2+nonzero+1, 0xff, 20-nonzero);
+    if(!add_pattern(pattern1+1, pattern2+1))
+      return 0;
+    nonzero++;
+  }
+
+  if(!lt)
+    return 1;
+
+  strcpy(pat1+offset, prefix);
+  strcpy(pat2+offset, prefix);
+  for(i=strlen(pat1);i < 34;i++) {
+    pat1[i]='1';
+    pat2[i]='z';
+  }
+  pat1[i]='\0';
+  pat2[i]='\0';
+
+  b58sz=i;
+  pattern_sz=25;
+  b58tobin(pattern1, &pattern_sz, pat1, b58sz);
+  b58sz=i;
+  pattern_sz=25;
+  b58tobin(pattern2, &pattern_sz, pat2, b58sz);
+
+#if 0
+  fprintf(stderr, "Y Low limit:   ");
+  for(j=0;j < 20;j++)
+    fprintf(stderr, "%02x", pattern1[j+1]);
+  fprintf(stderr, "\nY High limit:  ");
+  for(j=0;j < 20;j++)
+    fprintf(stderr, "%02x", pattern2[j+1]);
+  fprintf(stderr, "\n");
+#endif
+
+  if(pattern1[nonzero] && pattern2[nonzero])
+    return add_pattern(pattern1+1, pattern2+1);
+  else if(!pattern1[nonzero] && pattern2[nonzero]) {
+    pattern1[nonzero]=1;
+    memset(pattern1+nonzero+1, 0, 20-nonzero);
+    for(i=nonzero-1;i >= 0;i--)
+      if(pattern2[i])
+        break;
+    if(i >= 0) {
+      memset(pattern2, 0, i+1);
+      memset(pattern2+i+1, 0xff, 21-i-1);
+    }
+    return add_pattern(pattern1+1, pattern2+1);
+  }
+
+  return 1;
+}
+
+// Convert a prefix of addresses with a nonzero 'version' byte (P2SH, or P2PKH
+// on other networks) to a pattern. These addresses are always 34 characters
+// long, so padding the prefix with '1's and 'z's gives the range directly,
+// once clipped to payloads with that version. 'type' names the addresses in
+// error messages.
+//
+static bool add_version_prefix(const char *prefix, int version,
+                               const char *type)
+{
+  u8 low[25], high[25], limit[25];
+  char pat1[35], pat2[35];
+  size_t pattern_sz;
+  int i, plen=strlen(prefix);
+
+  /* Validate prefix */
+  if(plen > 28) {
+    fprintf(stderr, "Error: Prefix too long.\n");
+    return 0;
+  }
+
+  for(i=0;i < 34;i++) {
+    pat1[i]=(i < plen) ? prefix[i] : '1';
+    pat2[i]=(i < plen) ? prefix[i] : 'z';
+  }
+  pat1[i]=pat2[i]='\0';
+
+  pattern_sz=25;
+  if(!b58tobin(low, &pattern_sz, pat1, 34)) {
+    fprintf(stderr, "Error: Address '%s' contains an invalid character.\n",
+            prefix);
+    return 0;
+  }
+  pattern_sz=25;
+  b58tobin(high, &pattern_sz, pat2, 34);
+
+  /* Clip to payloads vv00..00 to vvff..ff */
+  memset(limit, 0x00, 25);
+  limit[0]=version;
+  if(memcmp(low, limit, 25) < 0)
+    memcpy(low, limit, 25);
+  memset(limit+1, 0xff, 24);
+  if(memcmp(high, limit, 25) > 0)
+    memcpy(high, limit, 25);
+
+  /* Some case variants may be impossible; skip those with -i */
+  if(memcmp(low, high, 25) > 0) {
+    if(anycase)
+      return 1;
+    fprintf(stderr, "Error: No %s address starts with '%s'.\n", type,
+            prefix);
+    return 0;
+  }
+
+  return add_pattern(low+1, high+1);
+}
+
+// Return the index in networks[] of the network whose addresses start like
+// 'prefix', and set 'encoding' to ENC_BASE58, ENC_BECH32 or ENC_CASHADDR.
+// Returns -1 if no network matches.
+//
+static int get_network(const char *prefix, int *encoding)
+{
+  int i, len;
+
+  for(i=0;i < NELEM(networks);i++) {
+    if(networks[i].hrp && (len=strlen(networks[i].hrp)) &&
+       !strncasecmp(prefix, networks[i].hrp, len) && prefix[len] == '1') {
+      *encoding=ENC_BECH32;
+      return i;
+    }
+    if(networks[i].cashaddr && (len=strlen(networks[i].cashaddr)) &&
+       !strncasecmp(prefix, networks[i].cashaddr, len) &&
+       prefix[len] == ':') {
+      *encoding=ENC_CASHADDR;
+      return i;
+    }
+  }
+  for(i=0;i < NELEM(networks);i++)
+    if(prefix[0] && strchr(networks[i].lead, prefix[0])) {
+      *encoding=ENC_BASE58;
+      return i;
+    }
+
+  return -1;
+}
+
+// Convert a bech32 P2WPKH address prefix ("bc1q...", "ltc1q..." or "tb1q...",
+// in either case) to a mask/value pair. Each character after the witness
+// version 'q' is 5 bits of the hashed public key, so up to 12 characters fit
+// in the first 64 bits. Taproot prefixes ("bc1p...") work the same way on the
+// x-only output key.
+//
+static bool add_bech32_prefix(const char *prefix)
+{
+  u64 mask=0, value=0;
+  int i, v, net, start, shift, upper=0, lower=0;
+
+  /* Validate prefix */
+  net=get_network(prefix, &i);
+  start=strlen(networks[net].hrp)+2;
+  if(strlen(prefix) > start+12) {
+    fprintf(stderr, "Error: Bech32 prefix too long.\n");
+    return 0;
+  }
+  for(i=0;prefix[i];i++) {
+    upper |= (prefix[i] >= 'A' && prefix[i] <= 'Z');
+    lower |= (prefix[i] >= 'a' && prefix[i] <= 'z');
+  }
+  if(upper && lower) {
+    fprintf(stderr, "Error: Bech32 prefix '%s' has mixed case.\n", prefix);
+    return 0;
+  }
+
+  if(prefix[start-1] && (prefix[start-1]|32) != (taproot_mode ? 'p' : 'q')) {
+    fprintf(stderr, "Error: Bech32 prefix '%s' is not a %s address.\n",
+            prefix, taproot_mode ? "taproot" : "P2WPKH");
+    return 0;
+  }
+
+  for(i=start,shift=59;i < strlen(prefix);i++,shift -= 5) {
+    if((v=bech32_value(prefix[i])) < 0) {
+      fprintf(stderr, "Error: Bech32 prefix '%s' contains an invalid "
+              "character.\n", prefix);
+      return 0;
+    }
+    mask |= 31ULL << shift;
+    value |= (u64)v << shift;
+  }
+
+  /* Resize the array every 100 elements */
+  if(!(num_bech32 % 100)) {
+    if(!(bech32_patterns=realloc(bech32_patterns,
+                                 (num_bech32+100)*sizeof(*bech32_patterns)))) {
+      perror("realloc");
+      return 0;
+    }
+  }
+
+  bech32_patterns[num_bech32].mask=mask;
+  bech32_patterns[num_bech32].value=value;
+  bech32_patterns[num_bech32].network=net;
+  bech32_patterns[num_bech32].cashaddr=0;
+  num_bech32++;
+  return 1;
+}
+
+// Convert a CashAddr P2PKH address prefix ("bitcoincash:q...", in either
+// case) to a mask/value pair. The payload starts with a zero version byte, so
+// the character after 'q' holds just the top 2 bits of the hashed public key
+// and must be one of 'q', 'p', 'z' or 'r'; each later character holds 5 more.
+//
+static bool add_cashaddr_prefix(const char *prefix)
+{
+  u64 mask=0, value=0;
+  int i, v, net, start, shift, width, upper=0, lower=0;
+
+  /* Validate prefix */
+  net=get_network(prefix, &i);
+  start=strlen(networks[net].cashaddr)+2;
+  if(strlen(prefix) > start+13) {
+    fprintf(stderr, "Error: CashAddr prefix too long.\n");
+    return 0;
+  }
+  for(i=0;prefix[i];i++) {
+    upper |= (prefix[i] >= 'A' && prefix[i] <= 'Z');
+    lower |= (prefix[i] >= 'a' && prefix[i] <= 'z');
+  }
+  if(upper && lower) {
+    fprintf(stderr, "Error: CashAddr prefix '%s' has mixed case.\n", prefix);
+    return 0;
+  }
+  if(prefix[start-1] && (prefix[start-1]|32) != 'q') {
+    fprintf(stderr, "Error: CashAddr prefix '%s' is not a P2PKH address.\n",
+            prefix);
+    return 0;
+  }
+
+  for(i=start,shift=64;i < strlen(prefix);i++) {
+    width=(i == start) ? 2 : 5;
+    if((v=bech32_value(prefix[i])) < 0 || v >> width) {
+      fprintf(stderr, "Error: No CashAddr address starts with '%s'.\n",
+              prefix);
+      return 0;
+    }
+    shift -= width;
+    mask |= ((1ULL << width)-1) << shift;
+    value |= (u64)v << shift;
+  }
+
+  /* Resize the array every 100 elements */
+  if(!(num_bech32 % 100)) {
+    if(!(bech32_patterns=realloc(bech32_patterns,
+                                 (num_bech32+100)*sizeof(*bech32_patterns)))) {
+      perror("realloc");
+      return 0;
+    }
+  }
+
+  bech32_patterns[num_bech32].mask=mask;
+  bech32_patterns[num_bech32].value=value;
+  bech32_patterns[num_bech32].network=net;
+  bech32_patterns[num_bech32].cashaddr=1;
+  num_bech32++;
+  return 1;
+}
+
+static int bech32_cmp(const void *a, const void *b)
+{
+  const struct bech32_pattern *x=a, *y=b;
+
+  if(x->network != y->network || x->cashaddr != y->cashaddr)
+    return (x->network-y->network)*2+(x->cashaddr-y->cashaddr);
+  if(x->value != y->value)
+    return (x->value > y->value)-(x->value < y->value);
+  return (x->mask > y->mask)-(x->mask < y->mask);
+}
+
+// Sort the bech32 prefixes and drop those already covered by a shorter one
+// of the same network and encoding. Each prefix covers the range
+// value..value|~mask; these ranges are nested or disjoint, so after sorting a
+// covered prefix always follows its cover.
+//
+static void compile_bech32()
+{
+  int i, n=0;
+
+  qsort(bech32_patterns, num_bech32, sizeof(*bech32_patterns), bech32_cmp);
+
+  for(i=0;i < num_bech32;i++)
+    if(!n || bech32_patterns[i].network != bech32_patterns[n-1].network ||
+       bech32_patterns[i].cashaddr != bech32_patterns[n-1].cashaddr ||
+       bech32_patterns[i].value >
+       (bech32_patterns[n-1].value | ~bech32_patterns[n-1].mask))
+      bech32_patterns[n++]=bech32_patterns[i];
+
+  num_bech32=n;
+}
+
+// Convert an Ethereum address prefix ("0x" and up to 16 hex digits) to a
+// mask/value pair on the first 64 bits of the address. Letters in mixed case
+// must also match the EIP-55 checksum case, unless matching with -i.
+//
+static bool add_eth_prefix(const char *prefix)
+{
+  u64 mask=0, value=0;
+  int i, c, shift, upper=0, lower=0;
+
+  /* Validate prefix */
+  if(strlen(prefix) > 18) {
+    fprintf(stderr, "Error: Ethereum prefix too long.\n");
+    return 0;
+  }
+
+  for(i=2,shift=60;(c=prefix[i]);i++,shift -= 4) {
+    if(c >= '0' && c <= '9')
+      c -= '0';
+    else if((c | 32) >= 'a' && (c | 32) <= 'f') {
+      upper |= (c < 'a');
+      lower |= (c >= 'a');
+      c=(c | 32)-'a'+10;
+    } else {
+      fprintf(stderr, "Error: Ethereum prefix '%s' contains an invalid "
+              "character.\n", prefix);
+      return 0;
+    }
+    mask |= 15ULL << shift;
+    value |= (u64)c << shift;
+  }
+
+  /* Resize the array every 100 elements */
+  if(!(num_eth % 100)) {
+    if(!(eth_patterns=realloc(eth_patterns,
+                              (num_eth+100)*sizeof(*eth_patterns)))) {
+      perror("realloc");
+      return 0;
+    }
+  }
+
+  eth_patterns[num_eth].mask=mask;
+  eth_patterns[num_eth].value=value;
+  eth_patterns[num_eth].checksum=(upper && lower && !anycase) ? prefix : NULL;
+  num_eth++;
+  return 1;
+}
+
+// Add pattern matches for all upper and lowercase variants of 'prefix'.
+//
+static bool add_anycase_prefix(const char *prefix)
+{
+  int i, plen=strlen(prefix);
+
+  /* Validate prefix */
+  if(get_network(prefix, &i) < 0 || i != ENC_BASE58) {
+    fprintf(stderr, "Error: Unknown address prefix '%s'.\n", prefix);
+    return 0;
+  } if(plen > 28) {
+    fprintf(stderr, "Error: Prefix too long.\n");
+    return 0;
+  }
+
+  return add_anycase(prefix, add_prefix);
+}
+
+// Call 'add' for all upper and lowercase variants of 'str' (at most 31
+// characters).
+//
+static bool add_anycase(const char *str, bool (*add)(const char *))
+{
+  /* Letters that can appear in an address as both upper and lowercase */
+  static const char letters[]="abcdefghjkmnpqrstuvwxyz";
+
+  u8 positions[32];
+  char lowercase[32], temp[32];
+  int i, j, plen=strlen(str), num_positions=0;
+
+  if(plen > 31) {
+    fprintf(stderr, "Error: '%s' is too long.\n", str);
+    return 0;
+  }
+
+  /* Convert string to all lowercase */
+  for(i=0;i < plen;i++) {
+    lowercase[i]=(str[i] >= 'A' && str[i] <= 'Z') ? (str[i]|32) : str[i];
+
+    /* "L" must always be uppercase */
+    if(lowercase[i] == 'l')
+      lowercase[i]='L';
+
+    /* Remember which letter positions can shift case */
+    else if(strchr(letters, lowercase[i]))
+      positions[num_positions++]=i;
+  }
+  lowercase[i]='\0';
+
+  /* Add all upper/lowercase variants */
+  for(i=0;i < (1 << num_positions);i++) {
+    strcpy(temp, lowercase);
+
+    /* Uppercase some positions in the string */
+    for(j=0;j < num_positions;j++)
+      if(i & (1 << j))
+        temp[positions[j]] &= ~32;
+
+    if(!add(temp))
+      return 0;
+  }
+
+  return 1;
+}
+
+// Add an address suffix to the suffixes[] list. Suffixes can be up to 10
+// characters long, as the tail of an address is computed modulo 58^10.
+//
+static bool add_suffix(const char *suffix)
+{
+  u8 bin[8];
+  size_t binsz=8, len=strlen(suffix);
+
+  /* Validate suffix */
+  if(!len || len > NELEM(suffix_lens)) {
+    fprintf(stderr, "Error: Suffix must be 1 to %d characters long.\n",
+            NELEM(suffix_lens));
+    return 0;
+  } if(!b58tobin(bin, &binsz, suffix, len)) {
+    fprintf(stderr, "Error: Suffix '%s' contains an invalid character.\n",
+            suffix);
+    return 0;
+  }
+
+  /* Resize the array every 100 elements */
+  if(!(num_suffixes % 100)) {
+    if(!(suffixes=realloc(suffixes, (num_suffixes+100)*sizeof(*suffixes)))) {
+      perror("realloc");
+      return 0;
+    }
+  }
+
+  suffixes[num_suffixes].value=be64(*(u64 *)bin);
+  suffixes[num_suffixes].len=len;
+  num_suffixes++;
+  return 1;
+}
+
+static int suffix_cmp(const void *a, const void *b)
+{
+  const struct suffix *x=a, *y=b;
+
+  if(x->len != y->len)
+    return x->len-y->len;
+  return (x->value > y->value)-(x->value < y->value);
+}
+
+// Binary search for 'value' in suffixes[start..end-1].
+//
+static bool find_suffix(int start, int end, u64 value)
+{
+  int mid;
+
+  while(start < end) {
+    mid=(start+end)/2;
+    if(suffixes[mid].value < value)
+      start=mid+1;
+    else if(suffixes[mid].value > value)
+      end=mid;
+    else
+      return 1;
+  }
+
+  return 0;
+}
+
+// Sort the suffix list, dropping duplicates and suffixes that end in a
+// shorter suffix already in the list, and index it by length.
+//
+static void compile_suffixes()
+{
+  u64 modulus=1;
+  int i, j, k, n=0, len=0;
+
+  qsort(suffixes, num_suffixes, sizeof(*suffixes), suffix_cmp);
+
+  for(i=0;i < num_suffixes;i++) {
+    if(n && !suffix_cmp(&suffixes[i], &suffixes[n-1]))
+      continue;
+
+    /* Check against all shorter lengths indexed so far */
+    for(j=0;j < num_suffix_lens;j++)
+      if(find_suffix(suffix_lens[j].start, suffix_lens[j].end,
+                     suffixes[i].value % suffix_lens[j].modulus))
+        break;
+    if(j < num_suffix_lens)
+      continue;
+
+    /* Start a new length group */
+    if(suffixes[i].len != len) {
+      for(len=suffixes[i].len,modulus=1,k=0;k < len;k++)
+        modulus *= 58;
+      suffix_lens[num_suffix_lens].start=n;
+      suffix_lens[num_suffix_lens].modulus=modulus;
+      num_suffix_lens++;
+    }
+
+    suffixes[n++]=suffixes[i];
+    suffix_lens[num_suffix_lens-1].end=n;
+  }
+
+  num_suffixes=n;
+}
+
+// Add a case-insensitive Base58 prefix to the heads[] list, as its first
+// B58_HEAD_DIGITS characters case folded.
+//
+static bool add_head(const char *prefix)
+{
+  static const char symbols[]="123456789abcdefghijklmnopqrstuvwxyz";
+  static const char alphabet[]=
+    "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+
+  u64 value=0;
+  int i, len=strlen(prefix);
+
+  /* Both cases of a letter fold to the same symbol */
+  if(!fold_symbol['1']) {
+    for(i=0;symbols[i];i++)
+      fold_symbol[(u8)symbols[i]]=fold_symbol[symbols[i] & ~32]=i+1;
+    for(i=0;alphabet[i];i++)
+      digit_symbol[i]=fold_symbol[(u8)alphabet[i]];
+  }
+
+  /* Validate prefix */
+  if(get_network(prefix, &i) < 0 || i != ENC_BASE58) {
+    fprintf(stderr, "Error: Unknown address prefix '%s'.\n", prefix);
+    return 0;
+  } if(p2sh_mode && prefix[0] != '3') {
+    fprintf(stderr, "Error: Can't mix '%c' and '3' prefixes.\n", prefix[0]);
+    return 0;
+  } if(len > 28) {
+    fprintf(stderr, "Error: Prefix too long.\n");
+    return 0;
+  }
+  for(i=0;i < len;i++) {
+    if(!fold_symbol[(u8)prefix[i]]) {
+      fprintf(stderr, "Error: Address '%s' contains an invalid character.\n",
+              prefix);
+      return 0;
+    }
+    if(i < B58_HEAD_DIGITS)
+      value=value << 6 | fold_symbol[(u8)prefix[i]];
+  }
+
+  /* Resize the array every 100 elements */
+  if(!(num_heads % 100)) {
+    if(!(heads=realloc(heads, (num_heads+100)*sizeof(*heads)))) {
+      perror("realloc");
+      return 0;
+    }
+  }
+
+  heads[num_heads].value=value;
+  heads[num_heads].len=min(len, B58_HEAD_DIGITS);
+  heads[num_heads].prefix=prefix;
+  num_heads++;
+  return 1;
+}
+
+static int head_cmp(const void *a, const void *b)
+{
+  const struct head *x=a, *y=b;
+
+  if(x->len != y->len)
+    return x->len-y->len;
+  if(x->value != y->value)
+    return (x->value > y->value)-(x->value < y->value);
+  return strcasecmp(x->prefix, y->prefix);
+}
+
+// Binary search for 'value' in heads[start..end-1]. Returns the first index
+// with that value, or -1.
+//
+static int find_head(int start, int end, u64 value)
+{
+  int mid, last=end;
+
+  while(start < end) {
+    mid=(start+end)/2;
+    if(heads[mid].value < value)
+      start=mid+1;
+    else
+      end=mid;
+  }
+
+  return (start < last && heads[start].value == value) ? start : -1;
+}
+
+// Return the chance of an address starting with 'prefix' in any case. The
+// leading '1's and four characters after them are expanded into patterns,
+// whose share of all hashes is exact; each character after that keeps 1 or 2
+// of the 58 digits.
+//
+static double get_head_chance(const char *prefix)
+{
+  /* Letters that can appear in an address as both upper and lowercase */
+  static const char letters[]="abcdefghjkmnpqrstuvwxyz";
+
+  static char last[32];
+  static double chance;
+  char temp[32];
+  double p;
+  int i, n=num_patterns, len=strlen(prefix);
+
+  /* Heads are sorted, so prefixes sharing their start come in a row */
+  for(i=0;prefix[i] == '1';i++);
+  i=min(i+4, len);
+  memcpy(temp, prefix, i);
+  temp[i]='\0';
+  if(strcasecmp(temp, last)) {
+    strcpy(last, temp);
+    chance=add_anycase(temp, add_prefix) ?
+      get_pattern_space(patterns+n, num_patterns-n) : 0;
+    num_patterns=n;
+  }
+
+  for(p=chance;i < len;i++)
+    p *= strchr(letters, prefix[i] | 32) ? 2/58.0 : 1/58.0;
+
+  return p;
+}
+
+// Sort the head list, dropping duplicates and heads that start with a
+// shorter head already in the list, and index it by length. Prefixes that no
+// address can start with are dropped too, as their patterns would be.
+//
+static void compile_heads()
+{
+  int i, j, k, n=0, len=0;
+  double p;
+
+  qsort(heads, num_heads, sizeof(*heads), head_cmp);
+
+  for(i=0;i < num_heads;i++) {
+    if(n && heads[i].len == heads[n-1].len &&
+       heads[i].value == heads[n-1].value &&
+       (!heads[n-1].prefix[heads[n-1].len] ||
+        !strcasecmp(heads[i].prefix, heads[n-1].prefix)))
+      continue;
+
+    /* Check against all shorter lengths indexed so far */
+    for(j=0;j < num_head_lens;j++) {
+      k=heads[head_lens[j].start].len;
+      if(k < heads[i].len &&
+         find_head(head_lens[j].start, head_lens[j].end,
+                   heads[i].value >> 6*(heads[i].len-k)) >= 0)
+        break;
+    }
+    if(j < num_head_lens)
+      continue;
+    if(!(p=get_head_chance(heads[i].prefix)))
+      continue;
+    head_freq += p;
+
+    /* Start a new length group */
+    if(heads[i].len != len) {
+      len=heads[i].len;
+      head_lens[num_head_lens].start=n;
+      head_lens[num_head_lens].shift=6*(B58_HEAD_DIGITS-len);
+      num_head_lens++;
+    }
+
+    heads[n++]=heads[i];
+    head_lens[num_head_lens-1].end=n;
+  }
+
+  num_heads=n;
+}
+
+// Set up the character to symbol mapping for the word automaton. With -i,
+// both cases of a letter map to the same symbol, including 'I', 'O' and 'l'
+// which are not Base58 characters themselves.
+//
+static void init_word_symbols()
+{
+  static const char alphabet[]=
+    "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+
+  s16 id[256];
+  int i, c, n=0;
+
+  memset(id, -1, sizeof(id));
+  memset(word_symbol, -1, sizeof(word_symbol));
+
+  for(i=0;alphabet[i];i++) {
+    c=(anycase && alphabet[i] >= 'A' && alphabet[i] <= 'Z') ?
+      (alphabet[i] | 32) : (u8)alphabet[i];
+    if(id[c] < 0)
+      id[c]=n++;
+    word_symbol[(u8)alphabet[i]]=id[c];
+    word_symbol_count[id[c]]++;
+
+    if(anycase && (c|32) >= 'a' && (c|32) <= 'z')
+      word_symbol[c|32]=word_symbol[c & ~32]=id[c];
+  }
+}
+
+// Allocate a new automaton state with no transitions, growing the tables
+// every 1024 states, and return its number (-1 if out of memory).
+//
+static int new_word_state()
+{
+  if(!(num_word_states % 1024)) {
+    if(!(word_next=realloc(word_next,
+                           (num_word_states+1024)*sizeof(*word_next))) ||
+       !(word_out=realloc(word_out, (num_word_states+1024)*sizeof(int)))) {
+      perror("realloc");
+      return -1;
+    }
+  }
+
+  memset(word_next[num_word_states], 0, sizeof(*word_next));
+  word_out[num_word_states]=-1;
+  return num_word_states++;
+}
+
+// Add a word to the words[] list and insert it in the automaton's trie.
+//
+static bool add_word(const char *word)
+{
+  int i, sym, state, next;
+
+  if(!num_words) {
+    init_word_symbols();
+    if(new_word_state() < 0)
+      return 0;
+  }
+
+  /* Validate word */
+  if(!word[0] || strlen(word) > 33) {
+    fprintf(stderr, "Error: Word must be 1 to 33 characters long.\n");
+    return 0;
+  }
+  for(i=0;word[i];i++)
+    if(word_symbol[(u8)word[i]] < 0) {
+      fprintf(stderr, "Error: Word '%s' contains an invalid character.\n",
+              word);
+      return 0;
+    }
+
+  /* Resize the array every 100 elements */
+  if(!(num_words % 100)) {
+    if(!(words=realloc(words, (num_words+100)*sizeof(char *)))) {
+      perror("realloc");
+      return 0;
+    }
+  }
+  if(!(words[num_words]=strdup(word))) {
+    perror("strdup");
+    return 0;
+  }
+
+  /* Walk down the trie, adding states as needed */
+  for(state=0,i=0;word[i];i++) {
+    sym=word_symbol[(u8)word[i]];
+    if(!word_next[state][sym]) {
+      if((next=new_word_state()) < 0)
+        return 0;
+      word_next[state][sym]=next;
+    }
+    state=word_next[state][sym];
+  }
+
+  /* Duplicate words keep the first index */
+  if(word_out[state] < 0)
+    word_out[state]=num_words;
+
+  num_words++;
+  return 1;
+}
+
+// Turn the word trie into a complete automaton. States are visited in order
+// of depth; each one inherits the output of its failure state (the longest
+// proper suffix that is also in the trie), and missing transitions are taken
+// from the failure state. Returns 0 if out of memory.
+//
+static bool compile_words()
+{
+  int *fail, *queue, head=0, tail=0, r, s, c;
+
+  if(!num_words)
+    return 1;
+
+  if(!(fail=malloc(2*num_word_states*sizeof(int)))) {
+    perror("malloc");
+    return 0;
+  }
+  queue=fail+num_word_states;
+
+  for(c=0;c < 58;c++)
+    if((s=word_next[0][c]))
+      fail[s]=0, queue[tail++]=s;
+
+  while(head < tail) {
+    r=queue[head++];
+    if(word_out[r] < 0)
+      word_out[r]=word_out[fail[r]];
+
+    for(c=0;c < 58;c++) {
+      if((s=word_next[r][c])) {
+        fail[s]=word_next[fail[r]][c];
+        queue[tail++]=s;
+      } else
+        word_next[r][c]=word_next[fail[r]][c];
+    }
+  }
+
+  free(fail);  return 1;
+}
+
+// Calculate the difficulty of finding a match from the pattern list, where
+// difficulty = 1/{valid pattern space}.
+//
+static double get_difficulty()
+{
+  double freq;
+  const char *p;
+  int i, bits;
+
+  /* Case-insensitive heads are estimated as they are compiled */
+  freq=get_pattern_space(patterns, num_patterns)+head_freq;
+
+  /* Each bech32 prefix fixes some number of leading bits */
+  for(i=0;i < num_bech32;i++)
+    freq += ldexp(1, -__builtin_popcountll(bech32_patterns[i].mask));
+
+  /* So does each Ethereum prefix, plus one bit per letter with EIP-55 */
+  for(i=0;i < num_eth;i++) {
+    bits=__builtin_popcountll(eth_patterns[i].mask);
+    for(p=eth_patterns[i].checksum;p && *p;p++)
+      bits += (*p >= 'A' && *p <= 'F') || (*p >= 'a' && *p <= 'f');
+    freq += ldexp(1, -bits);
+  }
+
+  return 1/freq;
+}
+
+// Return the share of all hashed public keys that fall in the 'n' patterns
+// at 'p'.
+//
+static double get_pattern_space(const struct pattern *p, int n)
+{
+  u32 total[5]={}, *low, *high;
+  u64 temp;
+  double freq;
+  int i, j;
+
+  /* Loop for each pattern */
+  for(i=0;i < n;i++) {
+    low=(u32 *)p[i].low;
+    high=(u32 *)p[i].high;
+
+    /* total += high-low */
+    for(j=4,temp=0;j >= 0;j--) {
+      temp += (u64)total[j]+be32(high[j])+(~be32(low[j])+(j == 4));
+      total[j]=temp;
+      temp >>= 32;
+    }
+  }
+
+  /* Add up fractions, from least significant to most significant */
+  freq  = total[4] / 1461501637330902918203684832716283019655932542976.0;
+  freq += total[3] / 340282366920938463463374607431768211456.0;
+  freq += total[2] / 79228162514264337593543950336.0;
+  freq += total[1] / 18446744073709551616.0;
+  freq += total[0] / 4294967296.0;
+
+  return freq;
+}
+
+// Estimate the difficulty of finding any word in a 34-character address,
+// whose first character is always '1'.
+//
+static double get_word_difficulty()
+{
+  double freq=0, p;
+  int i, len;
+  char *w;
+
+  for(i=0;i < num_words;i++) {
+    for(p=1,w=words[i];*w;w++)
+      p *= word_symbol_count[word_symbol[(u8)*w]]/58.0;
+    if((len=w-words[i]) < 34)
+      freq += (34-len)*p;
+  }
+
+  return 1/freq;
+}
+
+// Calculate the difficulty of matching any suffix in the suffix list.
+//
+static double get_suffix_difficulty()
+{
+  double freq=0;
+  int i;
+
+  for(i=0;i < num_suffix_lens;i++)
+    freq += (suffix_lens[i].end-suffix_lens[i].start)/
+            (double)suffix_lens[i].modulus;
+
+  return 1/freq;
+}
+
+#ifdef __LP64__
+
+// Returns 1 if the 20-byte hashed public key 'key' is between 'low' and
+// 'high', inclusive. For 64-bit CPUs.
+//
+static bool pubkeycmp(void *low, void *high, void *key)
+{
+  u64 *low64=low, *high64=high, *key64=key;
+  u32 *low32=low, *high32=high, *key32=key;
+
+  if(be64(key64[0]) < be64(low64[0])) return 0;
+  if(be64(key64[0]) > be64(low64[0])) goto next;
+  if(be64(key64[1]) < be64(low64[1])) return 0;
+  if(be64(key64[1]) > be64(low64[1])) goto next;
+  if(be32(key32[4]) < be32(low32[4])) return 0;
+
+  next:
+  if(be64(key64[0]) > be64(high64[0])) return 0;
+  if(be64(key64[0]) < be64(high64[0])) return 1;
+  if(be64(key64[1]) > be64(high64[1])) return 0;
+  if(be64(key64[1]) < be64(high64[1])) return 1;
+  if(be32(key32[4]) > be32(high32[4])) return 0;
+
+  return 1;
+}
+
+#else
+
+// Returns 1 if the 20-byte hashed public key 'key' is between 'low' and
+// 'high', inclusive. For 32-bit CPUs.
+//
+static bool pubkeycmp(void *low, void *high, void *key)
+{
+  u32 *low32=low, *high32=high, *key32=key;
+  int i;
+
+  for(i=0;i < 4;i++) {
+    if(be32(key32[i]) < be32(low32[i])) return 0;
+    if(be32(key32[i]) > be32(low32[i])) goto next;
+  }
+  if(be32(key32[i]) < be32(low32[i])) return 0;
+
+  next:
+  for(i=0;i < 4;i++) {
+    if(be32(key32[i]) > be32(high32[i])) return 0;
+    if(be32(key32[i]) < be32(high32[i])) return 1;
+  }
+  if(be32(key32[i]) > be32(high32[i])) return 0;
+
+  return 1;
+}
+
+#endif
+
+
+/**** Checkpoints ************************************************************/
+
+// Load the seeded search state from 'path', or start a new search with a
+// random seed if the file doesn't exist yet. The number of workers is taken
+// from the checkpoint, as it determines the ranges. Returns 0 on error.
+//
+static bool load_checkpoint(const char *path, int *threads)
+{
+  char line[256], hex[65]="";
+  unsigned long long value, *saved=NULL;
+  FILE *fp;
+  int i, fd, num=0;
+
+  checkpoint.path=path;
+  checkpoint.threads=*threads;
+
+  if(!(fp=fopen(path, "r"))) {
+    if(errno != ENOENT) {
+      perror(path);
+      return 0;
+    }
+
+    /* New search; pick a random seed */
+    if((fd=open("/dev/urandom", O_RDONLY|O_NOCTTY)) == -1 ||
+       read(fd, checkpoint.seed, 32) != 32) {
+      perror("/dev/urandom");
+      return 0;
+    }
+    close(fd);
+  } else {
+    while(fgets(line, sizeof(line), fp)) {
+      num++;
+      if(line[0] == '#' || line[0] == '\n' ||
+         sscanf(line, "seed %64s", hex) == 1 ||
+         sscanf(line, "found %d", &checkpoint.found) == 1 ||
+         sscanf(line, "last %llu", &checkpoint.last_result) == 1)
+        continue;
+
+      /* Positions follow the number of workers */
+      if(!saved && sscanf(line, "threads %d", &checkpoint.threads) == 1 &&
+         checkpoint.threads > 0 && checkpoint.threads <= 4096) {
+        if(!(saved=calloc(checkpoint.threads, sizeof(*saved)))) {
+          perror("calloc");
+          fclose(fp);
+          return 0;
+        }
+        continue;
+      }
+      if(saved && sscanf(line, "position %d %llu", &i, &value) == 2 &&
+         i >= 0 && i < checkpoint.threads) {
+        saved[i]=value;
+        continue;
+      }
+
+      fprintf(stderr, "Error: %s:%d: Invalid checkpoint line.\n", path, num);
+      return 0;
+    }
+    fclose(fp);
+
+    if(strlen(hex) != 64 || !saved) {
+      fprintf(stderr, "Error: %s: Invalid checkpoint.\n", path);
+      return 0;
+    }
+    for(i=0;i < 32;i++)
+      sscanf(hex+i*2, "%2hhx", &checkpoint.seed[i]);
+  }
+
+  /* Workers publish their positions through shared memory */
+  checkpoint.positions=mmap(NULL, checkpoint.threads*sizeof(u64),
+                            PROT_READ|PROT_WRITE, MAP_SHARED|MAP_ANONYMOUS,
+                            -1, 0);
+  if(checkpoint.positions == MAP_FAILED) {
+    perror("mmap");
+    return 0;
+  }
+
+  if(saved) {
+    for(i=0,value=0;i < checkpoint.threads;i++)
+      value += (checkpoint.positions[i]=saved[i]);
+    free(saved);
+    if(!quiet)
+      fprintf(stderr, "Resuming from %s: %llu keys scanned by %d workers\n",
+              path, value, checkpoint.threads);
+  }
+
+  *threads=checkpoint.threads;
+  return 1;
+}
+
+// Save the seeded search state: the seed, each worker's position, and the
+// result statistics of the job. The file is written under a temporary
+// name and renamed into place, so a crash never leaves a partial checkpoint.
+// Every key of the search derives from the seed, so only the owner may read
+// it.
+//
+static void save_checkpoint(u64 last_result, int found)
+{
+  char temp[1100];
+  FILE *fp;
+  int i, fd;
+
+  snprintf(temp, sizeof(temp), "%s.%d", checkpoint.path, getpid());
+  unlink(temp);
+  if((fd=open(temp, O_WRONLY|O_CREAT|O_EXCL, 0600)) == -1 ||
+     !(fp=fdopen(fd, "w"))) {
+    perror(temp);
+    if(fd != -1) {
+      close(fd);
+      unlink(temp);
+    }
+    return;
+  }
+
+  fprintf(fp, "# Super Vanitygen checkpoint\nseed ");
+  for(i=0;i < 32;i++)
+    fprintf(fp, "%02x", checkpoint.seed[i]);
+  fprintf(fp, "\nthreads %d\nfound %d\nlast %llu\n", checkpoint.threads,
+          found, last_result);
+  for(i=0;i < checkpoint.threads;i++)
+    fprintf(fp, "position %d %llu\n", i,
+            __atomic_load_n(&checkpoint.positions[i], __ATOMIC_ACQUIRE));
+
+  if(fflush(fp) || fsync(fileno(fp)) || fclose(fp) ||
+     rename(temp, checkpoint.path)) {
+    perror(checkpoint.path);
+    unlink(temp);
+  }
+}
+
+// Store the starting key of worker 'thread' in a seeded search to 'privkey',
+// in big-endian byte format: the master key SHA256(seed), clipped below 2^255,
+// plus thread*2^192 for a range of its own, plus the keys already scanned.
+//
+static void get_seeded_key(u64 privkey[4], int thread)
+{
+  align8 u8 block[64];
+  u64 pos=checkpoint.positions[thread];
+  int i;
+
+  sha256_prepare(block, 32);
+  memcpy(block, checkpoint.seed, 32);
+  sha256_hash((char *)privkey, block);
+
+  /* Convert key to cpu endianness */
+  for(i=0;i < 4;i++)
+    privkey[i]=be64(privkey[i]);
+
+  privkey[0]=(privkey[0] & 0x7fffffffffffffffULL)+thread;
+  if((privkey[3] += pos) < pos)
+    if(!++privkey[2])
+      if(!++privkey[1])
+        ++privkey[0];
+
+  /* Convert key back to big-endian byte format */
+  for(i=0;i < 4;i++)
+    privkey[i]=be64(privkey[i]);
+}
+
+
+/**** Range Scans ************************************************************/
+
+// Parse the range of private keys given with -R as "start:end" in hex, and
+// enable range scan mode. The engine's point additions can't double G or start
+// from the point at infinity, so ranges start at key 3, and they end short of
+// the group order, where the last batch could run past it. Ranges hold fewer
+// than 2^128 keys. Returns 0 on error.
+//
+static bool parse_range(const char *arg)
+{
+  u64 keys[2][4], diff[4];
+  char hex[65];
+  int i, j, len, borrow;
+
+  for(i=0;i < 2;i++,arg += len+1) {
+    len=strspn(arg, "0123456789abcdefABCDEF");
+    if(!len || len > 64 || arg[len] != (i ? '\0' : ':')) {
+      fprintf(stderr, "Error: -R needs a range of keys as 'start:end' in "
+              "hex.\n");
+      return 0;
+    }
+
+    /* Pad to 64 digits and read four 64-bit words, most significant first */
+    memset(hex, '0', 64-len);
+    memcpy(hex+64-len, arg, len);
+    hex[64]='\0';
+    for(j=0;j < 4;j++)
+      sscanf(hex+j*16, "%16llx", &keys[i][j]);
+  }
+
+  if(!keys[0][0] && !keys[0][1] && !keys[0][2] && keys[0][3] < 3) {
+    fprintf(stderr, "Error: -R ranges must start at key 3 or above.\n");
+    return 0;
+  }
+  if(keys[1][0] == ~0ULL) {
+    fprintf(stderr, "Error: -R range end is too close to the group order.\n");
+    return 0;
+  }
+
+  /* Span of the range, end-start */
+  for(j=3,borrow=0;j >= 0;j--) {
+    diff[j]=keys[1][j]-keys[0][j]-borrow;
+    borrow=keys[1][j] < keys[0][j] || (keys[1][j] == keys[0][j] && borrow);
+  }
+  if(borrow || diff[0] || diff[1]) {
+    fprintf(stderr, "Error: -R range must not end before it starts, and must "
+            "hold fewer than 2^128 keys.\n");
+    return 0;
+  }
+
+  memcpy(range.start, keys[0], 32);
+  range.span[0]=diff[2];
+  range.span[1]=diff[3];
+  range_mode=1;
+  return 1;
+}
+
+// Claim the next chunk of the range for a worker, storing the offset of its
+// first key (or giant step) to 'pos' and its length to 'left'. Returns 0 once
+// every chunk has been claimed.
+//
+static bool next_chunk(u64 *pos, u64 *left)
+{
+  u64 chunk=__atomic_fetch_add(range.next_chunk, 1, __ATOMIC_RELAXED);
+
+  if(chunk > (range.keys-1)/RANGE_CHUNK)
+    return 0;
+  *pos=chunk*RANGE_CHUNK;
+  *left=min(range.keys-*pos, (u64)RANGE_CHUNK);
+  return 1;
+}
+
+// Claim the next chunk of a range scan for a worker. Stores the key before the
+// chunk's first one to 'privkey', in big-endian byte format, and the number of
+// keys in the chunk to 'left'. Returns 0 once every chunk has been claimed.
+//
+static bool claim_chunk(u64 privkey[4], u64 *left)
+{
+  u64 pos;
+  int i;
+
+  if(!next_chunk(&pos, left))
+    return 0;
+
+  /* The engine starts with the key after 'privkey': start+pos-1 */
+  memcpy(privkey, range.start, 32);
+  if((privkey[3] += pos) < pos)
+    if(!++privkey[2])
+      if(!++privkey[1])
+        ++privkey[0];
+  if(!privkey[3]--)
+    if(!privkey[2]--)
+      if(!privkey[1]--)
+        privkey[0]--;
+
+  /* Convert key to big-endian byte format */
+  for(i=0;i < 4;i++)
+    privkey[i]=be64(privkey[i]);
+
+  return 1;
+}
+
+
+/**** Baby-Step Giant-Step ***************************************************/
+
+// Parse the public key given with -b, whose private key is to be found.
+//
+static bool parse_bsgs_key(const char *arg)
+{
+  size_t len;
+
+  if(!parse_pubkey(&bsgs.target, arg)) {
+    fprintf(stderr, "Error: -b needs a public key in hex.\n");
+    return 0;
+  }
+
+  secp256k1_eckey_pubkey_serialize(&bsgs.target, bsgs.pubkey, &len,
+                                   SECP256K1_EC_COMPRESSED);
+  hash160_many(bsgs.hash, bsgs.pubkey, 1);
+  bsgs_mode=1;
+  return 1;
+}
+
+// Returns the top 64 bits of the x coordinate of 'ge', whose high bits pick a
+// slot in the baby-step table and whose next 32 bits are its fingerprint.
+//
+static inline u64 bsgs_x(const secp256k1_ge *ge)
+{
+  align8 u8 x[32];
+
+  secp256k1_fe_get_b32(x, &ge->x);
+  return be64(*(u64 *)x);
+}
+
+// Insert the baby steps jG for j=first+1..last into the table, both multiples
+// of STEP. The chain counts down from (last+1)G, so it never has to double G
+// or pass through the point at infinity. Several processes insert at once,
+// claiming empty slots with compare-and-swap.
+//
+static void bsgs_fill(u64 first, u64 last)
+{
+  static secp256k1_gej base[STEP];
+  static secp256k1_ge rslt[STEP];
+  secp256k1_context *sec_ctx;
+  secp256k1_scalar scalar;
+  secp256k1_gej temp;
+  secp256k1_ge minus_g;
+  u64 j, x, slot, entry, empty, mask=(1ULL << bsgs.bits)-1;
+  int k;
+
+  sec_ctx=secp256k1_context_create(SECP256K1_CONTEXT_SIGN);
+
+  secp256k1_scalar_set_int(&scalar, 1);
+  secp256k1_ecmult_gen(&sec_ctx->ecmult_gen_ctx, &temp, &scalar);
+  secp256k1_ge_set_gej_var(&minus_g, &temp);
+  secp256k1_ge_neg(&minus_g, &minus_g);
+  secp256k1_fe_normalize_weak(&minus_g.y);
+
+  secp256k1_scalar_set_int(&scalar, last+1);
+  secp256k1_ecmult_gen(&sec_ctx->ecmult_gen_ctx, &base[STEP-1], &scalar);
+
+  for(j=last;j > first;j -= STEP) {
+    /* Element k of the batch is (j-k)G */
+    my_secp256k1_gej_add_ge_var(&base[0], &base[STEP-1], &minus_g);
+    for(k=1;k < STEP;k++)
+      my_secp256k1_gej_add_ge_var(&base[k], &base[k-1], &minus_g);
+    my_secp256k1_ge_set_all_gej_var(rslt, base);
+
+    for(k=0;k < STEP;k++) {
+      x=bsgs_x(&rslt[k]);
+      entry=(j-k) << 32 | (u32)(x >> (32-bsgs.bits));
+      for(slot=x >> (64-bsgs.bits);;slot=(slot+1) & mask) {
+        empty=0;
+        if(__atomic_compare_exchange_n(&bsgs.table[slot], &empty, entry, 0,
+                                       __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+          break;
+      }
+    }
+  }
+
+  secp256k1_context_destroy(sec_ctx);
+}
+
+// Map a baby-step table saved to the -T file read-only, in place of building
+// it. Returns 0 if there is no valid table file.
+//
+static bool load_bsgs_table()
+{
+  const struct bsgs_header *header;
+  struct stat st;
+  u8 *map;
+  int fd;
+
+  if((fd=open(bsgs.path, O_RDONLY)) == -1)
+    return 0;
+
+  if(fstat(fd, &st) || st.st_size < BSGS_TABLE ||
+     (map=mmap(NULL, st.st_size, PROT_READ, MAP_SHARED|MAP_POPULATE, fd,
+               0)) == MAP_FAILED) {
+    close(fd);
+    return 0;
+  }
+  close(fd);
+
+  /* Validate header */
+  header=(const struct bsgs_header *)map;
+  if(memcmp(header->magic, BSGS_MAGIC, 8) ||
+     header->version != BSGS_VERSION || header->bits < 13 ||
+     header->bits > 31 || header->baby_steps != (1ULL << header->bits)/2/
+     STEP*STEP || header->size != st.st_size ||
+     header->size != BSGS_TABLE+(8ULL << header->bits)) {
+    munmap(map, st.st_size);
+    return 0;
+  }
+
+  bsgs.bits=header->bits;
+  bsgs.baby_steps=header->baby_steps;
+  bsgs.table=(u64 *)(map+BSGS_TABLE);
+  if(!quiet)
+    fprintf(stderr, "Loaded baby-step table %s\n", bsgs.path);
+  return 1;
+}
+
+// Build the baby-step table in shared memory, split over 'threads' child
+// processes, or in a new -T file which is then renamed into place. Returns 0 on
+// error.
+//
+static bool build_bsgs_table(int threads)
+{
+  struct bsgs_header header={BSGS_MAGIC, BSGS_VERSION};
+  char temp[1100];
+  u64 batches=bsgs.baby_steps/STEP, size=BSGS_TABLE+(8ULL << bsgs.bits);
+  int i, fd=-1, status, pids[threads];
+  u8 *map;
+  bool ok=1;
+
+  if(bsgs.path) {
+    snprintf(temp, sizeof(temp), "%s.%d", bsgs.path, getpid());
+    if((fd=open(temp, O_RDWR|O_CREAT|O_TRUNC, 0644)) == -1 ||
+       ftruncate(fd, size)) {
+      perror(temp);
+      return 0;
+    }
+  }
+  if((map=mmap(NULL, size, PROT_READ|PROT_WRITE, fd == -1 ?
+               MAP_SHARED|MAP_ANONYMOUS : MAP_SHARED, fd, 0)) == MAP_FAILED) {
+    perror("mmap");
+    return 0;
+  }
+  bsgs.table=(u64 *)(map+BSGS_TABLE);
+
+  if(!quiet)
+    fprintf(stderr, "Building baby-step table...");
+
+  for(i=0;i < threads;i++) {
+    if((pids[i]=fork()) == -1) {
+      perror("fork");
+      threads=i;
+      ok=0;
+      break;
+    }
+    if(!pids[i]) {
+      set_working_cpu(i);
+      bsgs_fill(batches*i/threads*STEP, batches*(i+1)/threads*STEP);
+      _exit(0);
+    }
+  }
+  for(i=0;i < threads;i++)
+    if(waitpid(pids[i], &status, 0) == -1 || !WIFEXITED(status) ||
+       WEXITSTATUS(status))
+      ok=0;
+
+  if(!quiet)
+    fprintf(stderr, "\n");
+  if(!ok) {
+    fprintf(stderr, "Error: Failed to build the baby-step table.\n");
+    if(fd != -1)
+      unlink(temp);
+    return 0;
+  }
+
+  /* Save the table for later runs; failure to save is not an error */
+  if(fd != -1) {
+    header.bits=bsgs.bits;
+    header.baby_steps=bsgs.baby_steps;
+    header.size=size;
+    memcpy(map, &header, sizeof(header));
+    if(msync(map, size, MS_SYNC) || close(fd) || rename(temp, bsgs.path)) {
+      perror(bsgs.path);
+      unlink(temp);
+    } else if(!quiet)
+      fprintf(stderr, "Saved baby-step table %s\n", bsgs.path);
+  }
+
+  return 1;
+}
+
+// Set up a baby-step giant-step search: size the table by the memory limit,
+// or take it from the -T file, and count the giant steps needed to cover the
+// -R range. Returns 0 on error.
+//
+static bool bsgs_prepare(int threads)
+{
+  secp256k1_scalar scalar;
+  u64 stride, quot, rem, temp[4];
+  int i;
+
+  // Half-full tables keep probe sequences short. Giant steps must stay below
+  // 2^32 for the division below, which limits the table to 2^31 slots.
+  if(!bsgs.path || !load_bsgs_table()) {
+    bsgs.bits=63-__builtin_clzll(((u64)(bsgs.memory ?: VANITY_BSGS_DEFAULT)
+                                  << 20)/8);
+    bsgs.bits=RANGE(bsgs.bits, 13, 31);
+    bsgs.baby_steps=(1ULL << bsgs.bits)/2/STEP*STEP;
+    if(!build_bsgs_table(threads))
+      return 0;
+  }
+  stride=2*bsgs.baby_steps+1;
+
+  /* Giant steps from start+m cover the span, dividing 32 bits at a time */
+  quot=range.span[0]/stride;
+  rem=range.span[0]%stride;
+  temp[0]=quot;
+  for(i=1;i < 3;i++) {
+    quot=rem << 32 | (range.span[1] >> (64-32*i) & 0xffffffff);
+    temp[i]=quot/stride;
+    rem=quot%stride;
+  }
+  if(temp[0] || temp[1] >> 32 || (temp[1] << 32 | temp[2]) == ~0ULL) {
+    fprintf(stderr, "Error: -R range is too large for this baby-step table.\n");
+    return 0;
+  }
+  range.keys=(temp[1] << 32 | temp[2])+1;
+
+  /* Centers of the giant steps, start+m+g*S */
+  for(i=0;i < 4;i++)
+    temp[i]=be64(range.start[i]);
+  secp256k1_scalar_set_b32(&bsgs.first, (u8 *)temp, NULL);
+  memset(temp, 0, 24);
+  temp[3]=be64(bsgs.baby_steps);
+  secp256k1_scalar_set_b32(&scalar, (u8 *)temp, NULL);
+  secp256k1_scalar_add(&bsgs.first, &bsgs.first, &scalar);
+  temp[3]=be64(stride);
+  secp256k1_scalar_set_b32(&bsgs.stride, (u8 *)temp, NULL);
+
+  if(!quiet)
+    fprintf(stderr, "Baby steps: %llu (%llu MB)\nGiant steps: %llu\n",
+            bsgs.baby_steps, (8ULL << bsgs.bits) >> 20, range.keys);
+  return 1;
+}
+
+// Store the center of giant step 'g' plus 'k' more to 'c': start+m+(g+k)*S.
+//
+static void bsgs_center(secp256k1_scalar *c, u64 g, int k)
+{
+  u64 temp[4]={0, 0, 0, be64(g)};
+  secp256k1_scalar scalar;
+
+  secp256k1_scalar_set_b32(c, (u8 *)temp, NULL);
+  secp256k1_scalar_set_int(&scalar, abs(k));
+  if(k < 0)
+    secp256k1_scalar_negate(&scalar, &scalar);
+  secp256k1_scalar_add(c, c, &scalar);
+  secp256k1_scalar_mul(c, c, &bsgs.stride);
+  secp256k1_scalar_add(c, c, &bsgs.first);
+}
+
+// Send up 'key' plus 'offset' as the result if it is the private key of Q.
+// Returns 1 if so.
+//
+static bool bsgs_try(const secp256k1_scalar *key, long long offset)
+{
+  align8 u8 result[52];
+  secp256k1_scalar scalar;
+  u8 pubkey[33];
+
+  secp256k1_scalar_set_int(&scalar, offset < 0 ? -offset : offset);
+  if(offset < 0)
+    secp256k1_scalar_negate(&scalar, &scalar);
+  secp256k1_scalar_add(&scalar, &scalar, key);
+  if(secp256k1_scalar_is_zero(&scalar))
+    return 0;
+
+  secp256k1_scalar_get_b32(result, &scalar);
+  get_pubkey(pubkey, result);
+  if(memcmp(pubkey, bsgs.pubkey, 33))
+    return 0;
+
+  /* Either way, this worker is done */
+  memcpy(result+32, bsgs.hash, 20);
+  if(write(sock[1], result, 52) != 52)
+    perror("write");
+  return 1;
+}
+
+// Per-thread entry point of a baby-step giant-step search. Each chunk of giant
+// steps is one chain R=Q-cG, stepping by -SG; every batch of R is converted to
+// affine coordinates with one field inversion and looked up in the table. The
+// chain only reaches the point at infinity at R=0, where the key is c itself.
+//
+static void bsgs_engine(int thread)
+{
+  static secp256k1_gej base[STEP];
+  static secp256k1_ge rslt[STEP];
+  secp256k1_context *sec_ctx;
+  secp256k1_scalar center, scalar;
+  secp256k1_gej temp;
+  secp256k1_ge minus_s;
+  u64 pos, left, x, slot, entry, mask=(1ULL << bsgs.bits)-1;
+  u32 fp;
+  int k, n;
+
+  /* Set CPU affinity for this thread# (ignore any failures) */
+  set_working_cpu(thread);
+
+  /* Initialize the secp256k1 context */
+  sec_ctx=secp256k1_context_create(SECP256K1_CONTEXT_SIGN);
+
+  secp256k1_ecmult_gen(&sec_ctx->ecmult_gen_ctx, &temp, &bsgs.stride);
+  secp256k1_ge_set_gej_var(&minus_s, &temp);
+  secp256k1_ge_neg(&minus_s, &minus_s);
+  secp256k1_fe_normalize_weak(&minus_s.y);
+
+  while(next_chunk(&pos, &left)) {
+    // The chain starts one step before the chunk, at Q-(c-S)G. That is the
+    // point at infinity if the key is c-S, so try it first.
+    bsgs_center(&center, pos, -1);
+    if(bsgs_try(&center, 0))
+      return;
+    secp256k1_scalar_negate(&scalar, &center);
+    if(secp256k1_scalar_is_zero(&scalar))
+      secp256k1_gej_set_ge(&base[STEP-1], &bsgs.target);
+    else {
+      secp256k1_ecmult_gen(&sec_ctx->ecmult_gen_ctx, &temp, &scalar);
+      secp256k1_gej_add_ge_var(&base[STEP-1], &temp, &bsgs.target, NULL);
+
+      /* The addition is a doubling if Q=-(c-S)G */
+      if(secp256k1_fe_normalizes_to_zero_var(&base[STEP-1].z))
+        secp256k1_gej_double_var(&base[STEP-1], &temp, NULL);
+    }
+
+    for(;left;left -= n,pos += n) {
+      n=min(left, (u64)STEP);
+
+      /* Subtract S in Jacobian coordinates and save the result; repeat
+         STEP times */
+      my_secp256k1_gej_add_ge_var(&base[0], &base[STEP-1], &minus_s);
+      for(k=1;k < STEP;k++)
+        my_secp256k1_gej_add_ge_var(&base[k], &base[k-1], &minus_s);
+
+      // A zero z coordinate stays zero. The first one is at R=0, or at a
+      // doubling two steps after it, when the key is outside this chunk.
+      if(secp256k1_fe_normalizes_to_zero_var(&base[STEP-1].z)) {
+        for(k=0;!secp256k1_fe_normalizes_to_zero_var(&base[k].z);k++);
+        bsgs_center(&center, pos, k);
+        if(bsgs_try(&center, 0))
+          return;
+        break;
+      }
+
+      my_secp256k1_ge_set_all_gej_var(rslt, base);
+
+      /* Look up each x; a match for j means the key is c+j or c-j */
+      for(k=0;k < n;k++) {
+        x=bsgs_x(&rslt[k]);
+        fp=x >> (32-bsgs.bits);
+        for(slot=x >> (64-bsgs.bits);(entry=bsgs.table[slot]);
+            slot=(slot+1) & mask) {
+          if((u32)entry != fp)
+            continue;
+          bsgs_center(&center, pos, k);
+          if(bsgs_try(&center, entry >> 32) ||
+             bsgs_try(&center, -(long long)(entry >> 32)))
+            return;
+        }
+      }
+
+      thread_count[thread] += n;
+    }
+  }
+}
+
+
+/**** Distributed Search *****************************************************/
+
+// Listen for nodes on 'addr', given as "port" for the IPv4 loopback interface
+// only, or "host:port" ("[host]:port" for IPv6 addresses). Results come back
+// with their private keys in plain text, so other hosts have to be named.
+// Returns 0 on error.
+//
+static bool serve_nodes(const char *addr)
+{
+  struct addrinfo hints={.ai_flags=AI_PASSIVE, .ai_socktype=SOCK_STREAM};
+  struct addrinfo *list, *ai;
+  const char *port=strrchr(addr, ':');
+  char host[256]="127.0.0.1";
+  int ret, on=1;
+
+  if(port) {
+    if(addr[0] == '[' && port > addr && port[-1] == ']')
+      addr++;
+    if(port-addr >= sizeof(host)) {
+      fprintf(stderr, "Error: -S needs 'port' or 'host:port'.\n");
+      return 0;
+    }
+    memcpy(host, addr, port-addr);
+    host[port-addr-(port[-1] == ']')]='\0';
+    port++;
+  } else
+    port=addr;
+
+  if((ret=getaddrinfo(host, port, &hints, &list))) {
+    fprintf(stderr, "Error: %s: %s\n", addr, gai_strerror(ret));
+    return 0;
+  }
+
+  for(ai=list;ai;ai=ai->ai_next) {
+    if((listen_fd=socket(ai->ai_family, ai->ai_socktype,
+                         ai->ai_protocol)) == -1)
+      continue;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    if(!bind(listen_fd, ai->ai_addr, ai->ai_addrlen) &&
+       !listen(listen_fd, MAX_NODES))
+      break;
+    close(listen_fd);
+    listen_fd=-1;
+  }
+  freeaddrinfo(list);
+
+  if(listen_fd == -1) {
+    perror(addr);
+    return 0;
+  }
+
+  if(!quiet)
+    fprintf(stderr, "Coordinating nodes on %s port %s\n", host, port);
+  return 1;
+}
+
+// Read a line of at most 'size'-1 characters from socket 'fd' into 'line',
+// without the newline. Returns 0 on error or end of file.
+//
+static bool read_line(int fd, char *line, int size)
+{
+  int len=0;
+
+  while(read(fd, line+len, 1) == 1) {
+    if(line[len] == '\n') {
+      line[len]='\0';
+      return 1;
+    }
+    if(++len == size)
+      return 0;
+  }
+
+  return 0;
+}
+
+// Connect to the coordinator at 'addr' ("host:port") as a node, and receive
+// the search arguments, which replace 'argc' and 'argv' to be given to the job
+// as options and patterns. Returns 1 on success, 0 if the coordinator has no
+// more work, or -1 on error.
+//
+int vanity_join(const char *addr, int *argc, char ***argv)
+{
+  struct addrinfo hints={.ai_socktype=SOCK_STREAM};
+  struct addrinfo *list, *ai;
+  char host[256], line[1024], **args;
+  const char *port=strrchr(addr, ':');
+  int i, j, n, ret;
+
+  if(!port || port-addr >= sizeof(host)) {
+    fprintf(stderr, "Error: -J needs a coordinator address as 'host:port'.\n");
+    return -1;
+  }
+  memcpy(host, addr, port-addr);
+  host[port-addr]='\0';
+
+  if((ret=getaddrinfo(host, port+1, &hints, &list))) {
+    fprintf(stderr, "Error: %s: %s\n", addr, gai_strerror(ret));
+    return -1;
+  }
+  for(ai=list;ai;ai=ai->ai_next) {
+    if((coord_fd=socket(ai->ai_family, ai->ai_socktype,
+                        ai->ai_protocol)) == -1)
+      continue;
+    if(!connect(coord_fd, ai->ai_addr, ai->ai_addrlen))
+      break;
+    close(coord_fd);
+    coord_fd=-1;
+  }
+  freeaddrinfo(list);
+
+  if(coord_fd == -1) {
+    perror(addr);
+    return -1;
+  }
+
+  /* The job is "JOB n", then one argument per line */
+  if(!read_line(coord_fd, line, sizeof(line)) || !strcmp(line, "STOP")) {
+    close(coord_fd);
+    coord_fd=-1;
+    return 0;
+  }
+  if(sscanf(line, "JOB %d", &n) != 1 || n < 1) {
+    fprintf(stderr, "Error: %s: Invalid job.\n", addr);
+    return -1;
+  }
+  if(!(args=malloc((n+2)*sizeof(char *)))) {
+    perror("malloc");
+    return -1;
+  }
+
+  args[0]=(*argv)[0];
+  for(i=1;i <= n;i++)
+    if(!read_line(coord_fd, line, sizeof(line)) || !(args[i]=strdup(line))) {
+      fprintf(stderr, "Error: %s: Invalid job.\n", addr);
+      return -1;
+    }
+  args[i]=NULL;
+
+  // Coordinators may only pass the options of a search, besides prefixes.
+  // Any other option could make the node read or write files of its choosing.
+  for(i=1;i <= n;i++)
+    for(j=1;args[i][0] == '-' && args[i][j];j++) {
+      if(strchr("ikrsw", args[i][j]))
+        continue;
+      if(!strchr("Rcmp", args[i][j])) {
+        fprintf(stderr, "Error: %s: Option -%c not allowed in a job.\n", addr,
+                args[i][j]);
+        return -1;
+      }
+      i += !args[i][j+1];  /* The value is the next argument */
+      break;
+    }
+
+  *argc=n+1;
+  *argv=args;
+  return 1;
+}
+
+// Append 'arg' to the arguments handed to nodes, which vanity_start() has
+// made room for.
+//
+static void add_job_arg(const char *arg)
+{
+  job_args[num_job_args++]=(char *)arg;
+}
+
+// Send the search to a node, with range chunk 'chunk' in a range scan.
+//
+static void send_job(int fd, u64 chunk)
+{
+  u64 key[4], pos=chunk*NODE_CHUNK, len=min(range.keys-pos, NODE_CHUNK);
+  int i, j;
+
+  if(!range_mode) {
+    dprintf(fd, "JOB %d\n", num_job_args);
+  } else {
+    /* Keys start+pos to start+pos+len-1 */
+    dprintf(fd, "JOB %d\n-R\n", num_job_args+2);
+    for(i=0;i < 2;i++,pos += len-1) {
+      memcpy(key, range.start, 32);
+      if((key[3] += pos) < pos)
+        if(!++key[2])
+          if(!++key[1])
+            ++key[0];
+      for(j=0;j < 4;j++)
+        dprintf(fd, "%016llx", key[j]);
+      dprintf(fd, i ? "\n" : ":");
+    }
+  }
+
+  for(i=0;i < num_job_args;i++)
+    dprintf(fd, "%s\n", job_args[i]);
+}
+
+static void relay_signal(int sig)
+{
+  relay_stop=1;
+}
+
+// Coordinator's relay process, in place of the workers. Hands the search to
+// joining nodes, stores the key count of node i to thread_count[i] (counts of
+// nodes that left are added up in thread_count[0]), and passes their results
+// to the manager loop through the socket pair. Range chunks of nodes that
+// leave before they are done are handed out again.
+//
+static void relay(int threads)
+{
+  static struct {
+    int fd;          // Connection, or -1
+    int len;         // Bytes buffered in 'line'
+    bool busy;       // Scanning range chunk 'chunk'
+    u64 chunk;
+    char line[256];
+  } nodes[MAX_NODES];
+
+  fd_set readset;
+  u8 result[52];
+  u64 next=0, chunks=0, retry[MAX_NODES], value;
+  int i, j, fd, len, max_fd, num_retry=0;
+  char *end;
+
+  signal(SIGTERM, relay_signal);
+  signal(SIGINT, relay_signal);
+
+  for(i=1;i < MAX_NODES;i++)
+    nodes[i].fd=-1;
+  if(range_mode)
+    chunks=(range.keys-1)/NODE_CHUNK+1;
+
+  while(1) {
+    /* A range scan ends once every chunk is done */
+    for(i=1;i < MAX_NODES && !nodes[i].busy;i++);
+    if(range_mode && next == chunks && !num_retry && i == MAX_NODES)
+      relay_stop=1;
+
+    /* Tell every node to stop */
+    if(relay_stop) {
+      for(i=1;i < MAX_NODES;i++)
+        if(nodes[i].fd != -1)
+          dprintf(nodes[i].fd, "STOP\n");
+      _exit(0);
+    }
+
+    FD_ZERO(&readset);
+    FD_SET(listen_fd, &readset);
+    for(i=1,max_fd=listen_fd;i < MAX_NODES;i++)
+      if(nodes[i].fd != -1) {
+        FD_SET(nodes[i].fd, &readset);
+        max_fd=max(max_fd, nodes[i].fd);
+      }
+    if(select(max_fd+1, &readset, NULL, NULL, NULL) == -1) {
+      if(errno == EINTR)
+        continue;
+      perror("select");
+      _exit(1);
+    }
+
+    /* Hand the search to a new node, unless the range is all handed out */
+    if(FD_ISSET(listen_fd, &readset) &&
+       (fd=accept(listen_fd, NULL, NULL)) != -1) {
+      for(i=1;i < MAX_NODES && nodes[i].fd != -1;i++);
+      if(i == MAX_NODES || (range_mode && next == chunks && !num_retry)) {
+        dprintf(fd, "STOP\n");
+        close(fd);
+      } else {
+        nodes[i].fd=fd;
+        nodes[i].len=0;
+        if((nodes[i].busy=range_mode))
+          nodes[i].chunk=num_retry ? retry[--num_retry] : next++;
+        send_job(fd, nodes[i].chunk);
+      }
+    }
+
+    for(i=1;i < MAX_NODES;i++) {
+      if(nodes[i].fd == -1 || !FD_ISSET(nodes[i].fd, &readset))
+        continue;
+
+      /* A node that left keeps its count; its chunk is handed out again */
+      if((len=read(nodes[i].fd, nodes[i].line+nodes[i].len,
+                   sizeof(nodes[i].line)-1-nodes[i].len)) <= 0) {
+        thread_count[0] += thread_count[i];
+        thread_count[i]=0;
+        if(nodes[i].busy)
+          retry[num_retry++]=nodes[i].chunk;
+        nodes[i].busy=0;
+        close(nodes[i].fd);
+        nodes[i].fd=-1;
+        continue;
+      }
+      nodes[i].len += len;
+      nodes[i].line[nodes[i].len]='\0';
+
+      /* Handle each complete line */
+      while((end=strchr(nodes[i].line, '\n'))) {
+        *end='\0';
+        if(sscanf(nodes[i].line, "COUNT %llu", &value) == 1)
+          thread_count[i]=value;
+        else if(!strcmp(nodes[i].line, "DONE"))
+          nodes[i].busy=0;
+        else if(!strncmp(nodes[i].line, "RESULT ", 7) &&
+                strlen(nodes[i].line) == 7+104) {
+          for(j=0;j < 52;j++)
+            sscanf(nodes[i].line+7+j*2, "%2hhx", &result[j]);
+          if(write(sock[1], result, 52) != 52)
+            _exit(0);
+        }
+
+        nodes[i].len -= end+1-nodes[i].line;
+        memmove(nodes[i].line, end+1, nodes[i].len+1);
+      }
+
+      /* Drop nodes sending overlong lines */
+      if(nodes[i].len == sizeof(nodes[i].line)-1)
+        shutdown(nodes[i].fd, SHUT_RDWR);
+    }
+  }
+}
+
+/**** Daemon *****************************************************************/
+
+// Listen for daemon jobs on unix socket 'path', replacing a stale socket left
+// there. Only the user may connect, as clients are sent private keys. Returns
+// 0 on error.
+//
+static bool serve_requests(const char *path)
+{
+  struct sockaddr_un addr={.sun_family=AF_UNIX};
+  struct stat st;
+  mode_t mask;
+  int i;
+
+  if(strlen(path) >= sizeof(addr.sun_path)) {
+    fprintf(stderr, "Error: Socket path %s is too long.\n", path);
+    return 0;
+  }
+  strcpy(addr.sun_path, path);
+  if(!lstat(path, &st) && S_ISSOCK(st.st_mode))
+    unlink(path);
+
+  mask=umask(077);
+  if((daemon_fd=socket(AF_UNIX, SOCK_STREAM, 0)) == -1 ||
+     bind(daemon_fd, (struct sockaddr *)&addr, sizeof(addr)) ||
+     listen(daemon_fd, MAX_REQUESTS)) {
+    perror(path);
+    umask(mask);
+    return 0;
+  }
+  umask(mask);
+
+  for(i=0;i < MAX_REQUESTS;i++)
+    requests[i].fd=-1;
+
+  if(!quiet)
+    fprintf(stderr, "Serving jobs on %s\n", path);
+  return 1;
+}
+
+// Accept a new client, and read from the clients with input in 'readset'.
+//
+static void serve_clients(struct vanity_job *job, fd_set *readset)
+{
+  int i, fd;
+
+  if(FD_ISSET(daemon_fd, readset) &&
+     (fd=accept(daemon_fd, NULL, NULL)) != -1) {
+    for(i=0;i < MAX_REQUESTS && requests[i].fd != -1;i++);
+    if(i == MAX_REQUESTS) {
+      dprintf(fd, "ERROR\tToo many jobs\n");
+      close(fd);
+    } else
+      requests[i].fd=fd;
+  }
+
+  for(i=0;i < MAX_REQUESTS;i++)
+    if(requests[i].fd != -1 && FD_ISSET(requests[i].fd, readset))
+      read_request(job, i);
+}
+
+// Read the job of the client in request slot 'n', one line at a time. The job
+// is queued once complete, and cancelled if the client goes away.
+//
+static void read_request(struct vanity_job *job, int n)
+{
+  struct request *req=&requests[n];
+  char *end;
+  int len;
+
+  if((len=read(req->fd, req->line+req->len,
+               sizeof(req->line)-1-req->len)) <= 0) {
+    end_request(job, n, 0);
+    return;
+  }
+  req->len += len;
+  req->line[req->len]='\0';
+
+  /* Handle each complete line; anything after the job is ignored */
+  while((end=strchr(req->line, '\n'))) {
+    *end='\0';
+    if(req->queued)
+      ;
+    else if(!req->num_args) {
+      if(sscanf(req->line, "JOB %d", &req->num_args) != 1 ||
+         req->num_args < 1 || req->num_args > MAX_JOB_ARGS) {
+        reject_request(job, n, "Invalid job");
+        return;
+      }
+      if(!(req->args=malloc(req->num_args*sizeof(char *))) ||
+         !(req->inputs=malloc(req->num_args*sizeof(char *)))) {
+        reject_request(job, n, "Out of memory");
+        return;
+      }
+    } else if(!(req->args[req->args_read]=strdup(req->line))) {
+      reject_request(job, n, "Out of memory");
+      return;
+    } else if(++req->args_read == req->num_args) {
+      if(!parse_request(req)) {
+        reject_request(job, n, "Invalid options or no prefixes");
+        return;
+      }
+      if(!compile_request(job, n))
+        return;
+      req->queued=1;
+      req->seq=next_seq++;
+      start_requests(job, 0);
+    }
+
+    req->len -= end+1-req->line;
+    memmove(req->line, end+1, req->len+1);
+  }
+
+  if(req->len == sizeof(req->line)-1)
+    reject_request(job, n, "Line too long");
+}
+
+// Take the options and prefixes of a daemon job from its arguments, which are
+// given as on the command line, storing the prefixes to its inputs[] array.
+// Returns 0 if they make up no valid job.
+//
+static bool parse_request(struct request *req)
+{
+  char *arg;
+  int i, j;
+
+  req->count=1;
+
+  for(i=0;i < req->num_args;i++) {
+    arg=req->args[i];
+    if(arg[0] != '-') {
+      req->inputs[req->num_inputs++]=arg;
+      continue;
+    }
+
+    for(j=1;arg[j];j++) {
+      if(arg[j] == 'c') {
+        if(!arg[j+1] && i+1 == req->num_args)
+          return 0;
+        req->count=atoi(arg[j+1] ? arg+j+1 : req->args[++i]);
+        break;
+      } else if(arg[j] == 'i')
+        req->anycase=1;
+      else if(arg[j] == 'k')
+        req->keep_going=1;
+      else
+        return 0;
+    }
+  }
+
+  return req->num_inputs && req->count > 0;
+}
+
+// Compile the prefixes of the job in request slot 'n' into patterns of its
+// own. Rejects the job if it can't be run.
+//
+static bool compile_request(struct vanity_job *job, int n)
+{
+  struct request *req=&requests[n];
+  bool ok, unsupported;
+
+  /* Start over from an empty pattern list; the globals own no memory */
+  patterns=NULL;
+  pattern_buckets=NULL;
+  num_patterns=max_patterns=0;
+  bech32_patterns=NULL;
+  num_bech32=num_eth=0;
+  base58_networks=used_networks=0;
+  inputs=req->inputs;
+  num_inputs=req->num_inputs;
+  anycase=req->anycase;
+  current_request=-1;
+  ok=compile_prefixes(1, NULL);
+
+  // Workers only hash public keys, so P2SH, taproot and Ethereum prefixes,
+  // which need more work per key, aren't served. The modes they set would
+  // affect the checks of all jobs.
+  unsupported=p2sh_mode || taproot_mode || eth_mode;
+  p2sh_mode=taproot_mode=eth_mode=0;
+
+  /* Store the patterns in the job, to be freed with it */
+  req->num_inputs=num_inputs;
+  req->patterns=patterns;
+  req->pattern_buckets=pattern_buckets;
+  req->num_patterns=num_patterns;
+  req->bech32_patterns=bech32_patterns;
+  req->num_bech32=num_bech32;
+  req->base58_networks=base58_networks;
+  req->used_networks=used_networks;
+
+  if(!ok || unsupported) {
+    reject_request(job, n, ok ? "Unsupported address type" :
+                   "Invalid prefix");
+    return 0;
+  }
+  if(num_patterns > table_size || num_bech32 > TABLE_BECH32) {
+    reject_request(job, n, "Too many patterns");
+    return 0;
+  }
+
+  return 1;
+}
+
+// Make the job in request slot 'n' the current one: its patterns, options and
+// count are used for matching and reporting.
+//
+static void load_request(int n)
+{
+  struct request *req=&requests[n];
+
+  inputs=req->inputs;
+  num_inputs=req->num_inputs;
+  anycase=req->anycase;
+  patterns=req->patterns;
+  pattern_buckets=req->pattern_buckets;
+  num_patterns=max_patterns=req->num_patterns;
+  bech32_patterns=req->bech32_patterns;
+  num_bech32=req->num_bech32;
+  base58_networks=req->base58_networks;
+  used_networks=req->used_networks;
+  max_count=req->count;
+  keep_going=req->keep_going;
+  current_request=n;
+}
+
+// Start queued jobs in order of arrival, as long as their patterns fit in the
+// table along with those of the running jobs. The table is published again if
+// a job started, or if 'changed' is set because one retired.
+//
+static void start_requests(struct vanity_job *job, bool changed)
+{
+  int i, n, total=0, total_bech32=0;
+
+  for(i=0;i < MAX_REQUESTS;i++)
+    if(requests[i].running) {
+      total += requests[i].num_patterns;
+      total_bech32 += requests[i].num_bech32;
+    }
+
+  while(1) {
+    for(i=0,n=-1;i < MAX_REQUESTS;i++)
+      if(requests[i].queued && !requests[i].running &&
+         (n == -1 || requests[i].seq < requests[n].seq))
+        n=i;
+    if(n == -1 || total+requests[n].num_patterns > table_size ||
+       total_bech32+requests[n].num_bech32 > TABLE_BECH32)
+      break;
+
+    requests[n].running=1;
+    total += requests[n].num_patterns;
+    total_bech32 += requests[n].num_bech32;
+    changed=1;
+  }
+
+  if(changed)
+    publish_table(job);
+}
+
+// Fill in the pattern table no worker is using with the patterns of all
+// running daemon jobs, or with the prefixes still wanted with -n, publish it,
+// and wake up the workers if they were idle. Waits for any worker still
+// matching with that table, which moves on within one batch.
+//
+static void publish_table(struct vanity_job *job)
+{
+  struct table *table=tables[(epochs[0]+1) & 1];
+  int i;
+
+  for(i=1;i <= job->procs;i++)
+    while(__atomic_load_n(&epochs[i], __ATOMIC_ACQUIRE) != epochs[0])
+      usleep(100);
+
+  if(daemon_fd != -1)
+    merge_requests(table);
+  else {
+    memcpy(table->patterns, patterns, num_patterns*sizeof(*patterns));
+    if(pattern_buckets)
+      memcpy(table->buckets, pattern_buckets, sizeof(table->buckets));
+    memcpy(table->bech32, bech32_patterns,
+           num_bech32*sizeof(*bech32_patterns));
+    table->num_patterns=num_patterns;
+    table->num_bech32=num_bech32;
+  }
+
+  __atomic_store_n(&epochs[0], epochs[0]+1, __ATOMIC_RELEASE);
+  syscall(SYS_futex, &epochs[0], FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+// Merge the patterns of all running daemon jobs into 'table'.
+//
+static void merge_requests(struct table *table)
+{
+  struct request *req;
+  int i;
+
+  table->num_patterns=table->num_bech32=0;
+  for(i=0;i < MAX_REQUESTS;i++) {
+    if(!(req=&requests[i])->running)
+      continue;
+    memcpy(table->patterns+table->num_patterns, req->patterns,
+           req->num_patterns*sizeof(*patterns));
+    table->num_patterns += req->num_patterns;
+    memcpy(table->bech32+table->num_bech32, req->bech32_patterns,
+           req->num_bech32*sizeof(*bech32_patterns));
+    table->num_bech32 += req->num_bech32;
+  }
+
+  /* Sort and coalesce them in place, as for a single job */
+  patterns=table->patterns;
+  pattern_buckets=table->buckets;
+  num_patterns=table->num_patterns;
+  bech32_patterns=table->bech32;
+  num_bech32=table->num_bech32;
+  compile_patterns();
+  compile_bech32();
+  table->num_patterns=num_patterns;
+  table->num_bech32=num_bech32;
+  difficulty=max(get_difficulty(), 1);
+
+  /* The manager goes back to matching each job on its own */
+  patterns=NULL;
+  pattern_buckets=NULL;
+  num_patterns=max_patterns=0;
+  bech32_patterns=NULL;
+  num_bech32=0;
+  current_request=-1;
+}
+
+// Find the first running daemon job whose prefixes the key in 'result'
+// matches, and make it the current one, so a key is only ever sent to one
+// client. Returns its index, or -1 if the key is not valid or is not wanted
+// by any job, as for keys found for a job that has since retired.
+//
+static int find_request(const u8 result[52])
+{
+  u8 hash[20];
+  int i;
+
+  if(!verify_key(result))
+    return -1;
+
+  memcpy(hash, result+32, 20);
+  for(i=0;i < MAX_REQUESTS;i++) {
+    if(!requests[i].running)
+      continue;
+    load_request(i);
+    if((num_patterns && match_prefix(hash)) ||
+       (num_bech32 && match_bech32(hash)))
+      return i;
+  }
+
+  return -1;
+}
+
+// Tell the client in request slot 'n' why its job can't be run, and drop it.
+//
+static void reject_request(struct vanity_job *job, int n, const char *msg)
+{
+  dprintf(requests[n].fd, "ERROR\t%s\n", msg);
+  end_request(job, n, 0);
+}
+
+// Close the connection of the client in request slot 'n', after telling it
+// its job is done if 'done' is set, and free the slot. A running job is
+// retired from the table.
+//
+static void end_request(struct vanity_job *job, int n, bool done)
+{
+  struct request *req=&requests[n];
+  bool running=req->running;
+  int i;
+
+  if(done)
+    dprintf(req->fd, "DONE\t%d\n", req->found);
+  close(req->fd);
+
+  for(i=0;i < req->args_read;i++)
+    free(req->args[i]);
+  free(req->args);
+  free(req->inputs);
+  free(req->patterns);
+  free(req->pattern_buckets);
+  free(req->bech32_patterns);
+  memset(req, 0, sizeof(*req));
+  req->fd=-1;
+
+  /* Retire the job from the table, making room for queued ones */
+  if(n == current_request)
+    current_request=-1;
+  if(running)
+    start_requests(job, 1);
+}
+
+/**** Prefix Targets *********************************************************/
+
+// Set up a target for each prefix given, before they are compiled. Returns 0
+// if out of memory.
+//
+static bool init_targets()
+{
+  int i;
+
+  for(i=0;i < num_inputs;i++)
+    if(!add_target(inputs[i]))
+      return 0;
+
+  return 1;
+}
+
+// Add 'prefix' to the targets, wanting 'target_count' results. Returns 0 if
+// out of memory.
+//
+static bool add_target(char *prefix)
+{
+  struct target *t;
+  int encoding;
+
+  /* Resize the array every 1024 elements */
+  if(!(num_targets % 1024)) {
+    if(!(t=realloc(targets, (num_targets+1024)*sizeof(*targets)))) {
+      perror("realloc");
+      return 0;
+    }
+    targets=t;
+  }
+
+  t=&targets[num_targets++];
+  t->prefix=prefix;
+  t->base58=(get_network(prefix, &encoding) < 0 || encoding == ENC_BASE58);
+  t->found=0;
+  targets_left++;
+  return 1;
+}
+
+// Compile the prefixes still wanted into the pattern globals, for the address
+// types the workers were started with. Returns 0 if they don't compile or
+// don't fit in the pattern tables.
+//
+static bool compile_targets()
+{
+  bool ok, p2sh=p2sh_mode, taproot=taproot_mode;
+  int i;
+
+  num_inputs=num_patterns=num_bech32=num_eth=0;
+  base58_networks=used_networks=0;
+  for(i=0;i < num_targets;i++)
+    if(targets[i].found < target_count)
+      add_input(targets[i].prefix);
+
+  /* Workers hash keys for one set of address types, chosen when forked */
+  ok=compile_prefixes(1, NULL);
+  if(ok && (p2sh_mode != p2sh || taproot_mode != taproot || eth_mode)) {
+    fprintf(stderr, "Error: Prefixes of other address types can't be "
+            "added.\n");
+    ok=0;
+  }
+  p2sh_mode=p2sh;
+  taproot_mode=taproot;
+  eth_mode=0;
+  num_eth=0;
+
+  if(ok && (num_patterns > table_size || num_bech32 > TABLE_BECH32)) {
+    fprintf(stderr, "Error: Too many prefixes for the pattern table.\n");
+    ok=0;
+  }
+  if(ok)
+    difficulty=max(get_difficulty(), 1);
+  return ok;
+}
+
+// Count the prefixes still wanted that any of the 'n' addresses start with.
+// With 'credit', count a result for each, retiring those that now have all
+// they need.
+//
+static int match_targets(char (*addresses)[112], int n, bool credit)
+{
+  struct target *t;
+  int i, len, matched=0;
+
+  for(t=targets;t < targets+num_targets;t++) {
+    if(t->found >= target_count)
+      continue;
+    len=strlen(t->prefix);
+    for(i=0;i < n;i++)
+      if(!(t->base58 && !anycase ? strncmp : strncasecmp)(addresses[i],
+                                                         t->prefix, len))
+        break;
+    if(i == n)
+      continue;
+
+    matched++;
+    if(credit && ++t->found == target_count) {
+      targets_left--;
+      targets_changed=1;
+    }
+  }
+
+  return matched;
+}
+
+// Returns 1 if the valid key in 'result' has an address that starts with a
+// prefix still wanted. Keys sent up before their prefix retired have none.
+//
+static bool wanted_key(const u8 result[52])
+{
+  char addresses[8][112];
+  int nets[8];
+
+  return match_targets(addresses, get_addresses(result, nets, addresses), 0);
+}
+
+// Recompile the prefixes still wanted once some have retired, and publish
+// them to the workers. Large lists take a while to compile, so this is done
+// at most once a second; keys for retired prefixes are dropped meanwhile.
+//
+static void retire_targets(struct vanity_job *job)
+{
+  if(!targets_changed || job->finished || time(NULL) < next_retire)
+    return;
+
+  targets_changed=0;
+  next_retire=time(NULL)+1;
+  if(compile_targets())
+    publish_table(job);
+}
+
+static void reload_signal(int sig)
+{
+  reload_requested=1;
+}
+
+static int target_cmp(const void *a, const void *b)
+{
+  return strcmp(((const struct target *)a)->prefix,
+                ((const struct target *)b)->prefix);
+}
+
+// Add the prefixes of the -f list that aren't targets yet, when the manager
+// gets SIGHUP, and publish them to the workers along with those still wanted.
+// The list is left as it was if they can't be compiled, or memory runs out.
+//
+static void add_targets(struct vanity_job *job)
+{
+  struct target *known, key;
+  int i, old=num_targets, added=0;
+  bool ok=1;
+
+  /* Sort the known prefixes to look up those of the list */
+  if(!(known=malloc((old+1)*sizeof(*known)))) {
+    perror("malloc");
+    return;
+  }
+  memcpy(known, targets, old*sizeof(*known));
+  qsort(known, old, sizeof(*known), target_cmp);
+
+  num_inputs=0;
+  if(!load_list(options.list_path)) {
+    free(known);
+    return;
+  }
+
+  for(i=0;i < num_inputs;i++) {
+    key.prefix=inputs[i];
+    if(bsearch(&key, known, old, sizeof(*known), target_cmp) ||
+       (ok && !(ok=add_target(inputs[i])))) {
+      free(inputs[i]);
+      continue;
+    }
+    added++;
+  }
+  free(known);
+  if(!added)
+    return;
+
+  /* Drop them again if they can't all be searched with the others */
+  if(!ok || !compile_targets()) {
+    for(i=old;i < num_targets;i++)
+      free(targets[i].prefix);
+    num_targets=old;
+    targets_left -= added;
+    compile_targets();
+    return;
+  }
+
+  if(!quiet)
+    fprintf(stderr, "\nAdded %d prefixes from %s\n", added,
+            options.list_path);
+  publish_table(job);
+}
+
+
+/**** Hash Engine ************************************************************/
+
+// Returns 1 if the hashed public key 'pubkey' starts with any bech32 prefix,
+// with one AND and compare per prefix.
+//
+static bool match_bech32(const u8 *pubkey)
+{
+  u64 key=be64(*(const u64 *)pubkey);
+  int i;
+
+  for(i=0;i < num_bech32;i++)
+    if(unlikely((key & bech32_patterns[i].mask) == bech32_patterns[i].value))
+      return 1;
+
+  return 0;
+}
+
+// Returns 1 if the Ethereum address 'address' starts with any prefix. The
+// EIP-55 case of a candidate address is only checked for prefixes that need
+// it.
+//
+static bool match_eth(const u8 *address)
+{
+  u64 key=be64(*(const u64 *)address);
+  char str[43];
+  int i;
+
+  for(i=0;i < num_eth;i++)
+    if(unlikely((key & eth_patterns[i].mask) == eth_patterns[i].value)) {
+      if(!eth_patterns[i].checksum)
+        return 1;
+      eth_encode(str, address);
+      if(!strncmp(str, eth_patterns[i].checksum,
+                  strlen(eth_patterns[i].checksum)))
+        return 1;
+    }
+
+  return 0;
+}
+
+// Run 'address' through the word automaton. Returns the index of the first
+// word found, or -1.
+//
+static int match_word(const char *address)
+{
+  int state=0;
+
+  for(;*address;address++)
+    if(unlikely(word_out[state=word_next[state][word_symbol[(u8)*address]]]
+                >= 0))
+      return word_out[state];
+
+  return -1;
+}
+
+// Returns 1 if the hashed public key 'pubkey' is in any pattern range. The
+// ranges are sorted and disjoint, so only the last range starting at or below
+// the key needs to be checked; the prefilter buckets narrow down the search.
+//
+static bool match_prefix(void *pubkey)
+{
+  u32 bucket=((u8 *)pubkey)[0] << 8 | ((u8 *)pubkey)[1];
+  int low=pattern_buckets[bucket], high=pattern_buckets[bucket+1]-1, mid;
+
+  if(high < 0)
+    return 0;
+  if(low)
+    low--;
+
+  while(low < high) {
+    mid=(low+high+1)/2;
+    if(memcmp(patterns[mid].low, pubkey, 20) <= 0)
+      low=mid;
+    else
+      high=mid-1;
+  }
+
+  return pubkeycmp(patterns[low].low, patterns[low].high, pubkey);
+}
+
+// Returns 1 if the 25-byte address payload (version, hash, checksum) ends in
+// any of the wanted suffixes.
+//
+static bool match_suffix(const u8 payload[25])
+{
+  u64 tail=b58tail_addr(payload);
+  int i;
+
+  for(i=0;i < num_suffix_lens;i++)
+    if(unlikely(find_suffix(suffix_lens[i].start, suffix_lens[i].end,
+                            tail % suffix_lens[i].modulus)))
+      return 1;
+
+  return 0;
+}
+
+// Folded key of the first B58_HEAD_DIGITS characters of an address that
+// starts with 'ones' '1's, then the digits 'digits' (see b58head_addr()).
+//
+static u64 head_key(u64 digits, int ones)
+{
+  u8 sym[B58_HEAD_DIGITS];
+  u64 key=0;
+  int i;
+
+  for(i=B58_HEAD_DIGITS-1;i >= 0;i--,digits /= 58)
+    sym[i]=digit_symbol[digits % 58];
+  for(i=0;i < B58_HEAD_DIGITS;i++)
+    key=key << 6 | (i < ones ? digit_symbol[0] : sym[i-ones]);
+
+  return key;
+}
+
+// Returns 1 if an address of the hashed public key 'hash', in any network
+// used, starts with one of the case-insensitive prefixes. Only the leading
+// digits are worked out, then whole addresses of matching heads are checked.
+//
+static bool match_head(const u8 *hash)
+{
+  align8 u8 pub_block[64], cksum_block[64], checksum[32];
+  char address[40];
+  u64 digits[2], key;
+  int i, j, k, m, n, ones;
+
+  for(i=0;i < NELEM(networks);i++) {
+    if(!(base58_networks & 1 << i))
+      continue;
+    sha256_prepare(pub_block, 21);
+    pub_block[0]=p2sh_mode ? 0x05 : networks[i].version;
+    memcpy(pub_block+1, hash, 20);
+    address[0]='\0';
+
+    /* Both candidates when the digits can't be told apart this early */
+    n=b58head_addr(digits, &ones, pub_block);
+    for(j=0;j < n;j++) {
+      key=head_key(digits[j], ones);
+      for(k=0;k < num_head_lens;k++) {
+        m=find_head(head_lens[k].start, head_lens[k].end,
+                    key >> head_lens[k].shift);
+        if(likely(m < 0))
+          continue;
+
+        /* Encode the whole address to compare longer prefixes */
+        if(!address[0]) {
+          sha256_prepare(cksum_block, 32);
+          sha256_hash(cksum_block, pub_block);
+          sha256_hash(checksum, cksum_block);
+          memcpy(pub_block+21, checksum, 4);
+          b58enc_addr(address, pub_block);
+        }
+
+        for(;m < head_lens[k].end &&
+             heads[m].value == key >> head_lens[k].shift;m++)
+          if(!strncasecmp(address, heads[m].prefix, strlen(heads[m].prefix)))
+            return 1;
+      }
+    }
+  }
+
+  return 0;
+}
+
+// Build tweak_table[] for taproot mode: 32 windows of 255 points each,
+// converted to affine coordinates with a single field inversion. Returns 0 if
+// out of memory.
+//
+static bool taproot_prepare()
+{
+  secp256k1_context *sec_ctx;
+  secp256k1_gej *gej, temp;
+  secp256k1_ge *ge, base=secp256k1_ge_const_g;
+  int i, j;
+
+  sec_ctx=secp256k1_context_create(SECP256K1_CONTEXT_SIGN);
+  if(!(gej=calloc(32*255, sizeof(*gej))) || !(ge=malloc(32*255*sizeof(*ge))) ||
+     !(tweak_table=malloc(32*sizeof(*tweak_table)))) {
+    perror("malloc");
+    return 0;
+  }
+
+  /* The last byte of a big-endian tweak has weight 1 */
+  for(i=31;i >= 0;i--) {
+    /* Point additions here have no special cases, such as doubling or
+       the infinity flag, so the array starts out zeroed */
+    secp256k1_gej_set_ge(&gej[i*255], &base);
+    secp256k1_gej_double_var(&gej[i*255+1], &gej[i*255], NULL);
+    for(j=2;j < 255;j++)
+      secp256k1_gej_add_ge_var(&gej[i*255+j], &gej[i*255+j-1], &base, NULL);
+
+    /* Base of the next window is 256 times this one */
+    temp=gej[i*255+254];
+    secp256k1_gej_add_ge_var(&temp, &temp, &base, NULL);
+    secp256k1_ge_set_gej_var(&base, &temp);
+  }
+
+  secp256k1_ge_set_all_gej_var(32*255, ge, gej, &sec_ctx->error_callback);
+  for(i=0;i < 32;i++)
+    for(j=0;j < 255;j++)
+      secp256k1_ge_to_storage(&tweak_table[i][j+1], &ge[i*255+j]);
+
+  free(gej);
+  free(ge);
+  secp256k1_context_destroy(sec_ctx);
+  return 1;
+}
+
+// Compute the x-only taproot output keys Q = P + tG of a batch of internal
+// keys, where P is the key taken with even y and t is the TapTweak hash of its
+// x coordinate. Each tG is summed from tweak_table[] one byte window at a
+// time, in affine coordinates; the additions of a window across the batch
+// share a single field inversion. Sets skip[k] for tweaks that overflow the
+// group order, which are invalid.
+//
+static void taproot_keys(u8 (*xonly)[32], bool *skip,
+                         const secp256k1_ge *points, const u8 (*pubkeys)[33])
+{
+  static u8 tweaks[STEP][32];
+  static secp256k1_ge sum[STEP], addend[STEP];
+  static secp256k1_fe dx[STEP], dxi[STEP];
+  secp256k1_scalar scalar;
+  secp256k1_fe lambda, t, u;
+  int i, k, overflow;
+
+  /* Hash all tweaks in one batch */
+  taptweak_many(tweaks[0], pubkeys[0], STEP);
+
+  for(k=0;k < STEP;k++) {
+    secp256k1_scalar_set_b32(&scalar, tweaks[k], &overflow);
+    skip[k]=overflow;
+
+    if(pubkeys[k][0] == 0x03) {
+      secp256k1_ge_neg(&sum[k], &points[k]);
+      secp256k1_fe_normalize_weak(&sum[k].y);
+    } else
+      sum[k]=points[k];
+  }
+
+  for(i=0;i < 32;i++) {
+    /* Differences of x coordinates; a zero byte adds nothing */
+    for(k=0;k < STEP;k++) {
+      if(!tweaks[k][i]) {
+        secp256k1_fe_set_int(&dx[k], 1);
+        continue;
+      }
+      secp256k1_ge_from_storage(&addend[k], &tweak_table[i][tweaks[k][i]]);
+      secp256k1_fe_negate(&dx[k], &sum[k].x, 1);
+      secp256k1_fe_add(&dx[k], &addend[k].x);
+    }
+
+    secp256k1_fe_inv_all_var(STEP, dxi, dx);
+
+    // Affine addition: lambda = (y2-y1)/(x2-x1), x3 = lambda^2-x1-x2 and
+    // y3 = lambda*(x1-x3)-y1. Sums can't meet a doubling or infinity, short
+    // of solving the discrete logarithm of the internal key.
+    for(k=0;k < STEP;k++) {
+      if(!tweaks[k][i])
+        continue;
+      secp256k1_fe_negate(&t, &sum[k].y, 1);
+      secp256k1_fe_add(&t, &addend[k].y);
+      secp256k1_fe_mul(&lambda, &t, &dxi[k]);
+
+      secp256k1_fe_sqr(&t, &lambda);
+      secp256k1_fe_negate(&u, &sum[k].x, 1);
+      secp256k1_fe_add(&t, &u);
+      secp256k1_fe_negate(&u, &addend[k].x, 1);
+      secp256k1_fe_add(&t, &u);
+      secp256k1_fe_normalize_weak(&t);
+
+      secp256k1_fe_negate(&u, &t, 1);
+      secp256k1_fe_add(&u, &sum[k].x);
+      sum[k].x=t;
+      secp256k1_fe_mul(&t, &lambda, &u);
+      secp256k1_fe_negate(&sum[k].y, &sum[k].y, 1);
+      secp256k1_fe_add(&sum[k].y, &t);
+      secp256k1_fe_normalize_weak(&sum[k].y);
+    }
+  }
+
+  for(k=0;k < STEP;k++) {
+    secp256k1_fe_normalize(&sum[k].x);
+    secp256k1_fe_get_b32(xonly[k], &sum[k].x);
+  }
+}
+
+// Queue a result on this worker's ring, waiting while the ring is full, and
+// wake up the manager if the ring was empty. Returns 0 if the manager is gone.
+//
+static bool ring_push(struct result_ring *ring, const u8 result[52])
+{
+  u32 head=ring->head, tail;
+
+  while(head-(tail=__atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE)) >=
+        RING_SIZE)
+    usleep(1000);
+
+  memcpy(ring->result[head % RING_SIZE], result, 52);
+  __atomic_store_n(&ring->head, head+1, __ATOMIC_RELEASE);
+
+  /* Ring doorbell; a full socket buffer means the manager is already awake */
+  if(head == tail && send(sock[1], "", 1, MSG_DONTWAIT) == -1 &&
+     errno != EAGAIN)
+    return 0;
+
+  return 1;
+}
+
+// Switch a worker to the pattern table last published, if it has changed,
+// and sleep for as long as the table is empty.
+//
+static void load_table(int thread)
+{
+  struct table *table;
+  u32 epoch;
+
+  while(1) {
+    epoch=__atomic_load_n(&epochs[0], __ATOMIC_ACQUIRE);
+    if(epoch != epochs[thread+1]) {
+      table=tables[epoch & 1];
+      patterns=table->patterns;
+      pattern_buckets=table->buckets;
+      num_patterns=table->num_patterns;
+      bech32_patterns=table->bech32;
+      num_bech32=table->num_bech32;
+      __atomic_store_n(&epochs[thread+1], epoch, __ATOMIC_RELEASE);
+    }
+    if(num_patterns || num_bech32)
+      return;
+
+    /* Wait for the next table */
+    syscall(SYS_futex, &epochs[0], FUTEX_WAIT, epoch, NULL, NULL, 0);
+  }
+}
+
+// Per-thread entry point.
+//
+static void engine(int thread)
+{
+  static secp256k1_gej base[STEP];
+  static secp256k1_ge rslt[STEP];
+  static u8 pubkeys[STEP][33], hashes[STEP][20], payloads[STEP][25];
+  static u8 scripts[STEP][20], xonly[STEP][32];
+  static u8 points[STEP][64], digests[STEP][32];
+  static char addresses[STEP][36];
+  static bool skip[STEP];
+  secp256k1_context *sec_ctx;
+  secp256k1_scalar scalar_key, scalar_one={{1}};
+  secp256k1_gej temp;
+  secp256k1_ge offset;
+
+  align8 u8 result[52], *pubkey=result+32;
+  u64 privkey[4], left=0;
+  int j, k, n, fd, len;
+  sigset_t term;
+
+  // Split-key orders each advance their own segment of 'seg' keys; the last
+  // STEP-used elements of the batch are padding.
+  int seg=STEP/max(num_orders, 1), used=seg*max(num_orders, 1);
+
+  /* Set CPU affinity for this thread# (ignore any failures) */
+  set_working_cpu(thread);
+
+  /* Initialize the secp256k1 context */
+  sec_ctx=secp256k1_context_create(SECP256K1_CONTEXT_SIGN);
+  sigemptyset(&term);
+  sigaddset(&term, SIGTERM);
+  sigaddset(&term, SIGINT);
+
+  rekey:
+
+  /* Seeded searches start from the worker's own range instead */
+  if(checkpoint.path) {
+    get_seeded_key(privkey, thread);
+    goto start;
+  }
+
+  /* Range scans take the next chunk of the range, until none are left */
+  if(range_mode) {
+    if(!claim_chunk(privkey, &left))
+      return;
+    goto start;
+  }
+
+  // Generate a random private key. Specifically, any 256-bit number from 0x1
+  // to 0xFFFF FFFF FFFF FFFF FFFF FFFF FFFF FFFE BAAE DCE6 AF48 A03B BFD2 5E8C
+  // D036 4140 is a valid private key.
+
+  if((fd=open("/dev/urandom", O_RDONLY|O_NOCTTY)) == -1) {
+    perror("/dev/urandom");
+    return;
+  }
+
+  /* Use 32 bytes from /dev/urandom as starting private key */
+  do {
+    if((len=read(fd, privkey, 32)) != 32) {
+      if(len != -1)
+        errno=EAGAIN;
+      perror("/dev/urandom");
+      return;
+    }
+  } while(privkey[0]+1 < 2);  /* Ensure only valid private keys */
+
+  close(fd);
+
+  start:
+
+  /* Copy private key to secp256k1 scalar format */
+  secp256k1_scalar_set_b32(&scalar_key, (u8 *)privkey, NULL);
+
+  /* Convert key to cpu endianness */
+  privkey[0]=be64(privkey[0]);
+  privkey[1]=be64(privkey[1]);
+  privkey[2]=be64(privkey[2]);
+  privkey[3]=be64(privkey[3]);
+
+  /* Create group elements for both the random private key and the value 1 */
+  secp256k1_ecmult_gen(&sec_ctx->ecmult_gen_ctx, &base[STEP-1], &scalar_key);
+  secp256k1_ecmult_gen(&sec_ctx->ecmult_gen_ctx, &temp, &scalar_one);
+  secp256k1_ge_set_gej_var(&offset, &temp);
+
+  // Split-key searches start from the customer's public key instead, or from
+  // each order's key at the end of its segment.
+  if(num_orders) {
+    temp=base[STEP-1];
+    for(j=0;j < num_orders;j++)
+      secp256k1_gej_add_ge_var(&base[j*seg+seg-1], &temp, &orders[j].base,
+                               NULL);
+  } else if(split_mode)
+    secp256k1_gej_add_ge_var(&base[STEP-1], &base[STEP-1], &split_base, NULL);
+
+  /* Main Loop */
+
+  while(1) {
+    /* Workers pick up newly published patterns between batches */
+    if(epochs)
+      load_table(thread);
+
+    // Seeded searches are only stopped or interrupted between batches, so
+    // that the results sent and the position published always cover the same
+    // keys, and a resumed search reports none of them again.
+    if(checkpoint.path)
+      sigprocmask(SIG_BLOCK, &term, NULL);
+
+    /* Add 1 in Jacobian coordinates and save the result; repeat STEP times,
+       or 'seg' times within each order's segment */
+    for(j=0;j < used;j += seg) {
+      my_secp256k1_gej_add_ge_var(&base[j], &base[j+seg-1], &offset);
+      for(k=j+1;k < j+seg;k++)
+        my_secp256k1_gej_add_ge_var(&base[k], &base[k-1], &offset);
+    }
+
+    /* Padding shares the inversion, so it must hold valid points */
+    for(k=used;k < STEP;k++)
+      base[k]=base[used-1];
+
+    /* Convert all group elements from Jacobian to affine coordinates */
+    my_secp256k1_ge_set_all_gej_var(rslt, base);
+
+    /* Extract the 33-byte compressed public keys from the group elements, or
+       the 64-byte uncompressed ones (x and y) for Ethereum */
+    if(eth_mode)
+      for(k=0;k < STEP;k++) {
+        secp256k1_fe_get_b32(points[k], &rslt[k].x);
+        secp256k1_fe_get_b32(points[k]+32, &rslt[k].y);
+      }
+    else
+      for(k=0;k < STEP;k++) {
+        pubkeys[k][0]=(secp256k1_fe_is_odd(&rslt[k].y) ? 0x03 : 0x02);
+        secp256k1_fe_get_b32(pubkeys[k]+1, &rslt[k].x);
+      }
+
+    /* Hash all public keys in one batch, or tweak them in taproot mode */
+    if(eth_mode)
+      keccak256_blocks(digests[0], points[0], STEP);
+    else if(taproot_mode)
+      taproot_keys(xonly, skip, rslt, (const u8 (*)[33])pubkeys);
+    else
+      hash160_many(hashes[0], pubkeys[0], STEP);
+
+    /* The last batch of a range scan ends early */
+    n=range_mode ? min((u64)used, left) : used;
+    thread_count[thread] += n;
+
+    /* In P2SH mode, prefixes match the hashes of the redeem scripts */
+    if(multisig)
+      hash160_multisig_many(scripts[0], pubkeys[0], STEP, multisig);
+    else if(p2sh_mode)
+      hash160_p2wpkh_many(scripts[0], hashes[0], STEP);
+
+    /* In bulk generation mode, every key is a result */
+    if(gen_format && !emit_keys(privkey, (const u8 (*)[20])hashes))
+      return;
+
+    /* In suffix and word modes, checksum all candidate addresses in one
+       batch; words also need the full Base58 encoding */
+    if(num_suffixes || num_words) {
+      for(k=0;k < STEP;k++) {
+        payloads[k][0]=0x00;
+        memcpy(payloads[k]+1, hashes[k], 20);
+      }
+      checksum_many(payloads[0], 21, 25, STEP);
+      if(num_words)
+        b58enc_addr_many(addresses[0], 36, payloads[0], STEP);
+    }
+
+    for(k=0;k < n;k++) {
+      /* Each order has its own patterns; skip those already served */
+      if(num_orders && !(k % seg)) {
+        if(orders_done[k/seg]) {
+          k += seg-1;
+          continue;
+        }
+        load_order(k/seg);
+      }
+
+      /* Compare with byte patterns, bech32 prefixes, suffixes or words */
+      if(likely(eth_mode ? !match_eth(digests[k]+12) :
+                taproot_mode ? skip[k] || !match_bech32(xonly[k]) :
+                num_words ? match_word(addresses[k]) < 0 :
+                num_suffixes ? !match_suffix(payloads[k]) :
+                !(num_patterns &&
+                  match_prefix(p2sh_mode ? scripts[k] : hashes[k])) &&
+                !(num_heads &&
+                  match_head(p2sh_mode ? scripts[k] : hashes[k])) &&
+                !(num_bech32 && match_bech32(hashes[k]))))
+        continue;
+
+      /* Taproot results still carry the internal public key hash */
+      if(taproot_mode)
+        hash160_many(hashes[k], pubkeys[k], 1);
+
+      /* Ethereum addresses are the last 20 bytes of the Keccak hash */
+      memcpy(pubkey, eth_mode ? digests[k]+12 : hashes[k], 20);
+      get_key(result, privkey, k % seg);
+
+      /* Queue result and keep scanning sequentially */
+      if(no_rekey) {
+        if(!ring_push(&rings[thread], result))
+          return;
+        continue;
+      }
+
+      /* Announce (PrivKey,PubKey) result */
+      if(write(sock[1], result, 52) != 52)
+        return;
+
+      /* Pick a new random starting private key, unless scanning a range */
+      if(!checkpoint.path && !range_mode)
+        goto rekey;
+    }
+
+    /* Increment privkey by STEP, or by the segment size with orders */
+    if((privkey[3] += seg) < seg)  /* Check for overflow */
+      if(!++privkey[2])
+        if(!++privkey[1])
+          ++privkey[0];
+
+    /* Publish the position once every key of the batch has been matched */
+    if(checkpoint.path) {
+      __atomic_store_n(&checkpoint.positions[thread],
+                       checkpoint.positions[thread]+used, __ATOMIC_RELEASE);
+      sigprocmask(SIG_UNBLOCK, &term, NULL);
+    }
+
+    /* Move on to the next chunk once this one is done */
+    if(range_mode && !(left -= n))
+      goto rekey;
+  }
+}
+
+// Store the big-endian private key of the k'th element of a batch, which is
+// privkey+k+1, to 'key'.
+//
+static void get_key(u8 key[32], const u64 privkey[4], int k)
+{
+  u64 temp[4];
+
+  temp[0]=privkey[0];
+  temp[1]=privkey[1];
+  temp[2]=privkey[2];
+  if((temp[3]=privkey[3]+k+1) < privkey[3])
+    if(!++temp[2])
+      if(!++temp[1])
+        ++temp[0];
+
+  /* Convert key to big-endian byte format */
+  temp[0]=be64(temp[0]);
+  temp[1]=be64(temp[1]);
+  temp[2]=be64(temp[2]);
+  temp[3]=be64(temp[3]);
+  memcpy(key, temp, 32);
+}
+
+// Write out 'len' bytes of the output buffer. Returns 0 on error, or once
+// the reader of a pipe has gone away. Other errors are reported by the first
+// worker to hit one, and fail the job.
+//
+static bool flush_output(const char *buf, int len)
+{
+  int ret, done;
+
+  for(done=0;done < len;done += ret)
+    if((ret=write(out_fd, buf+done, len-done)) == -1) {
+      if(errno == EINTR) {
+        ret=0;
+        continue;
+      }
+      if(errno != EPIPE &&
+         !__atomic_exchange_n(gen_failed, 1, __ATOMIC_RELAXED))
+        perror(options.out_path ? options.out_path : "write");
+      return 0;
+    }
+
+  return 1;
+}
+
+// Bulk generation mode: append every key of the current batch to this
+// worker's output buffer, which is written out in large chunks. Returns 0 once
+// the requested number of keys has been claimed or the output is closed.
+//
+static bool emit_keys(const u64 privkey[4], const u8 (*hashes)[20])
+{
+  static u8 wif[STEP][38], addr[STEP][25];
+  static char *buf;
+  static int len;
+  u64 issued;
+  int k, n=STEP;
+
+  if(!buf && !(buf=malloc(OUTBUF_SIZE))) {
+    perror("malloc");
+    return 0;
+  }
+
+  /* Another worker's output failed */
+  if(*gen_failed)
+    return 0;
+
+  /* Claim keys from this batch against the global count; errors of the last
+     flush are reported by flush_output() */
+  if(!keep_going) {
+    issued=__atomic_fetch_add(gen_issued, STEP, __ATOMIC_RELAXED);
+    if(issued >= max_count) {
+      flush_output(buf, len);
+      return 0;
+    }
+    n=min((u64)STEP, max_count-issued);
+  }
+
+  if(gen_format == GEN_BIN) {
+    for(k=0;k < n;k++) {
+      if(len+52 > out_chunk) {
+        if(!flush_output(buf, len))
+          return 0;
+        len=0;
+      }
+      get_key(buf+len, privkey, k);
+      memcpy(buf+len+32, hashes[k], 20);
+      len += 52;
+    }
+  } else {
+    /* Build private key and address payloads; checksum them in batches */
+    for(k=0;k < n;k++) {
+      wif[k][0]=0x80;
+      get_key(wif[k]+1, privkey, k);
+      wif[k][33]=0x01;  /* 1=Compressed Public Key */
+      addr[k][0]=0x00;
+      memcpy(addr[k]+1, hashes[k], 20);
+    }
+    checksum_many(wif[0], 34, 38, n);
+    checksum_many(addr[0], 21, 25, n);
+
+    for(k=0;k < n;k++) {
+      if(len+100 > out_chunk) {
+        if(!flush_output(buf, len))
+          return 0;
+        len=0;
+      }
+      len += b58enc_wif(buf+len, wif[k]);
+      buf[len++]=',';
+      len += b58enc_addr(buf+len, addr[k]);
+      buf[len++]='\n';
+    }
+  }
+
+  /* Stop once the last claimed key is written */
+  if(n < STEP) {
+    flush_output(buf, len);
+    return 0;
+  }
+
+  return 1;
+}
+
+// Compute the compressed public key of 'privkey', or of the customer's key
+// plus 'privkey' in split-key mode.
+//
+static void get_pubkey(u8 pubkey[33], const u8 privkey[32])
+{
+  static secp256k1_context *sec_ctx;
+  secp256k1_scalar scalar;
+  secp256k1_gej gej;
+  secp256k1_ge ge;
+
+  /* Initialize the secp256k1 context once */
+  if(!sec_ctx)
+    sec_ctx=secp256k1_context_create(SECP256K1_CONTEXT_SIGN);
+
+  secp256k1_scalar_set_b32(&scalar, privkey, NULL);
+  secp256k1_ecmult_gen(&sec_ctx->ecmult_gen_ctx, &gej, &scalar);
+  if(split_mode)
+    secp256k1_gej_add_ge_var(&gej, &gej, &split_base, NULL);
+  secp256k1_ge_set_gej(&ge, &gej);
+  secp256k1_fe_normalize(&ge.x);
+  secp256k1_fe_normalize(&ge.y);
+
+  pubkey[0]=(secp256k1_fe_is_odd(&ge.y) ? 0x03 : 0x02);
+  secp256k1_fe_get_b32(pubkey+1, &ge.x);
+}
+
+// Compute the x-only taproot output key of the internal private key 'privkey'
+// for a key path spend only (BIP 86).
+//
+static void get_taproot_key(u8 xonly[32], const u8 privkey[32])
+{
+  static secp256k1_context *sec_ctx;
+  secp256k1_scalar scalar;
+  secp256k1_gej gej;
+  secp256k1_ge ge;
+  u8 pubkey[33], tweak[32];
+
+  /* Initialize the secp256k1 context once */
+  if(!sec_ctx)
+    sec_ctx=secp256k1_context_create(SECP256K1_CONTEXT_SIGN);
+
+  /* Internal key with even y */
+  get_pubkey(pubkey, privkey);
+  pubkey[0]=0x02;
+  secp256k1_eckey_pubkey_parse(&ge, pubkey, 33);
+
+  taptweak_many(tweak, pubkey, 1);
+  secp256k1_scalar_set_b32(&scalar, tweak, NULL);
+  secp256k1_ecmult_gen(&sec_ctx->ecmult_gen_ctx, &gej, &scalar);
+  secp256k1_gej_add_ge_var(&gej, &gej, &ge, NULL);
+  secp256k1_ge_set_gej(&ge, &gej);
+  secp256k1_fe_normalize(&ge.x);
+
+  secp256k1_fe_get_b32(xonly, &ge.x);
+}
+
+// Returns 1 if the private key (first 32 bytes of 'result') correctly produces
+// the public key (last 20 bytes of 'result').
+//
+static bool verify_key(const u8 result[52])
+{
+  bool valid;
+
+  verify_keys((const u8 (*)[52])result, &valid, 1);
+  return valid;
+}
+
+// Verify 'n' (PrivKey,PubKey) tuples at once, setting valid[i] for each one
+// whose private key correctly produces its public key hash. The conversions
+// to affine coordinates share a single field inversion.
+//
+static void verify_keys(const u8 (*results)[52], bool *valid, int n)
+{
+  static secp256k1_context *sec_ctx;
+  secp256k1_scalar scalar, scalar_one={{1}};
+  secp256k1_gej gej[n];
+  secp256k1_ge ge[n];
+  u8 pubkeys[n][33], hashes[n][20], points[n][64], digests[n][32];
+  int i, overflow;
+
+  if(!n)
+    return;
+
+  /* Initialize the secp256k1 context once */
+  if(!sec_ctx)
+    sec_ctx=secp256k1_context_create(SECP256K1_CONTEXT_SIGN);
+
+  for(i=0;i < n;i++) {
+    /* Copy private key to secp256k1 scalar format */
+    secp256k1_scalar_set_b32(&scalar, results[i], &overflow);
+    valid[i]=!overflow && !secp256k1_scalar_is_zero(&scalar);
+    if(!valid[i])
+      scalar=scalar_one;  /* Invalid private key; keep the batch well-formed */
+
+    /* Create a group element for the private key we're verifying */
+    secp256k1_ecmult_gen(&sec_ctx->ecmult_gen_ctx, &gej[i], &scalar);
+    if(split_mode)
+      secp256k1_gej_add_ge_var(&gej[i], &gej[i], &split_base, NULL);
+  }
+
+  /* Convert to affine coordinates */
+  secp256k1_ge_set_all_gej_var(n, ge, gej, &sec_ctx->error_callback);
+
+  /* Extract the 33-byte compressed public keys from the group elements */
+  for(i=0;i < n;i++) {
+    pubkeys[i][0]=(secp256k1_fe_is_odd(&ge[i].y) ? 0x03 : 0x02);
+    secp256k1_fe_get_b32(pubkeys[i]+1, &ge[i].x);
+  }
+
+  /* Hash public keys; Ethereum addresses hash both coordinates instead */
+  if(eth_mode) {
+    for(i=0;i < n;i++) {
+      secp256k1_fe_get_b32(points[i], &ge[i].x);
+      secp256k1_fe_get_b32(points[i]+32, &ge[i].y);
+    }
+    keccak256_blocks(digests[0], points[0], n);
+    for(i=0;i < n;i++)
+      memcpy(hashes[i], digests[i]+12, 20);
+  } else
+    hash160_many(hashes[0], pubkeys[0], n);
+
+  /* Verify that the hashed public keys match the results */
+  for(i=0;i < n;i++)
+    valid[i]=valid[i] && !memcmp(hashes[i], results[i]+32, 20);
+}
+
+
+/**** libsecp256k1 Overrides *************************************************/
+
+static void my_secp256k1_fe_inv_all_gej_var(secp256k1_fe *r,
+                                            const secp256k1_gej *a)
+{
+  secp256k1_fe u;
+  int i;
+
+  r[0]=a[0].z;
+
+  for(i=1;i < STEP;i++)
+    secp256k1_fe_mul(&r[i], &r[i-1], &a[i].z);
+
+  secp256k1_fe_inv_var(&u, &r[--i]);
+
+  for(;i > 0;i--) {
+    secp256k1_fe_mul(&r[i], &r[i-1], &u);
+    secp256k1_fe_mul(&u, &u, &a[i].z);
+  }
+
+  r[0]=u;
+}
+
+static void my_secp256k1_ge_set_all_gej_var(secp256k1_ge *r,
+                                            const secp256k1_gej *a)
+{
+  static secp256k1_fe azi[STEP];
+  int i;
+
+  my_secp256k1_fe_inv_all_gej_var(azi, a);
+
+  for(i=0;i < STEP;i++)
+    secp256k1_ge_set_gej_zinv(&r[i], &a[i], &azi[i]);
+}
+
+static void my_secp256k1_gej_add_ge_var(secp256k1_gej *r,
+                                        const secp256k1_gej *a,
+                                        const secp256k1_ge *b)
+{
+  /* 8 mul, 3 sqr, 4 normalize, 12 mul_int/add/negate */
+  secp256k1_fe z12, u1, u2, s1, s2, h, i, i2, h2, h3, t;
+
+  secp256k1_fe_sqr(&z12, &a->z);
+  u1 = a->x; secp256k1_fe_normalize_weak(&u1);
+  secp256k1_fe_mul(&u2, &b->x, &z12);
+  s1 = a->y; secp256k1_fe_normalize_weak(&s1);
+  secp256k1_fe_mul(&s2, &b->y, &z12); secp256k1_fe_mul(&s2, &s2, &a->z);
+  secp256k1_fe_negate(&h, &u1, 1); secp256k1_fe_add(&h, &u2);
+  secp256k1_fe_negate(&i, &s1, 1); secp256k1_fe_add(&i, &s2);
+  secp256k1_fe_sqr(&i2, &i);
+  secp256k1_fe_sqr(&h2, &h);
+  secp256k1_fe_mul(&h3, &h, &h2);
+  secp256k1_fe_mul(&r->z, &a->z, &h);
+  secp256k1_fe_mul(&t, &u1, &h2);
+  r->x = t; secp256k1_fe_mul_int(&r->x, 2); secp256k1_fe_add(&r->x, &h3);
+  secp256k1_fe_negate(&r->x, &r->x, 3); secp256k1_fe_add(&r->x, &i2);
+  secp256k1_fe_negate(&r->y, &r->x, 5); secp256k1_fe_add(&r->y, &t);
+  secp256k1_fe_mul(&r->y, &r->y, &i);
+  secp256k1_fe_mul(&h3, &h3, &s1); secp256k1_fe_negate(&h3, &h3, 1);
+  secp256k1_fe_add(&r->y, &h3);
+}
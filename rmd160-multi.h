@@ -0,0 +1,98 @@
+/* rmd160-multi.h - Multi-buffer RIPEMD-160 kernel template */
+
+// This file is included by rmd160.c once for each vector width. Before
+// inclusion, define:
+//
+//   VEC     A GCC vector type of 32-bit unsigned integers
+//   LANES   Number of elements in VEC
+//   KERNEL  Name of the function to generate
+//
+// The generated function hashes 'n' independent, already padded 64-byte
+// blocks, LANES at a time, with one message per vector lane.
+
+#define VROL(x,n) (((x) << (n)) | ((x) >> (32-(n))))
+
+#define VROUND(a, b, c, d, e, f, k, x, s) { \
+  (a) += f((b), (c), (d)) + (x) + (k); \
+  (a) = VROL((a), (s)) + (e); \
+  (c) = VROL((c), 10); \
+}
+
+// One group of 16 rounds on both lanes. The five working variables rotate
+// positions every round, so each group is unrolled by 5 with a remainder of
+// one round to restore the caller's variable order.
+#define VGROUP(j, fl, kl, fr, kr) { \
+  for(i=j;i < j+15;i += 5) { \
+    VROUND(aa, bb, cc, dd, ee, fl, kl, X[rmd160_r[i]],   rmd160_s[i]); \
+    VROUND(ee, aa, bb, cc, dd, fl, kl, X[rmd160_r[i+1]], rmd160_s[i+1]); \
+    VROUND(dd, ee, aa, bb, cc, fl, kl, X[rmd160_r[i+2]], rmd160_s[i+2]); \
+    VROUND(cc, dd, ee, aa, bb, fl, kl, X[rmd160_r[i+3]], rmd160_s[i+3]); \
+    VROUND(bb, cc, dd, ee, aa, fl, kl, X[rmd160_r[i+4]], rmd160_s[i+4]); \
+    VROUND(aaa, bbb, ccc, ddd, eee, fr, kr, X[rmd160_rr[i]],   rmd160_ss[i]); \
+    VROUND(eee, aaa, bbb, ccc, ddd, fr, kr, X[rmd160_rr[i+1]], rmd160_ss[i+1]); \
+    VROUND(ddd, eee, aaa, bbb, ccc, fr, kr, X[rmd160_rr[i+2]], rmd160_ss[i+2]); \
+    VROUND(ccc, ddd, eee, aaa, bbb, fr, kr, X[rmd160_rr[i+3]], rmd160_ss[i+3]); \
+    VROUND(bbb, ccc, ddd, eee, aaa, fr, kr, X[rmd160_rr[i+4]], rmd160_ss[i+4]); \
+  } \
+  VROUND(aa, bb, cc, dd, ee, fl, kl, X[rmd160_r[i]], rmd160_s[i]); \
+  VROUND(aaa, bbb, ccc, ddd, eee, fr, kr, X[rmd160_rr[i]], rmd160_ss[i]); \
+  temp=ee; ee=dd; dd=cc; cc=bb; bb=aa; aa=temp; \
+  temp=eee; eee=ddd; ddd=ccc; ccc=bbb; bbb=aaa; aaa=temp; \
+}
+
+static void KERNEL(char *output, const char *input, int n)
+{
+  VEC X[16], aa, bb, cc, dd, ee, aaa, bbb, ccc, ddd, eee, temp;
+  u32 *out;
+  int i, j, k, lanes;
+
+  for(k=0;k < n;k += LANES) {
+    lanes=min(n-k, LANES);
+
+    /* Transpose input blocks into vectors of little-endian words */
+    for(j=0;j < lanes;j++)
+      for(i=0;i < 16;i++)
+        X[i][j]=le32(((const u32 *)(input+(k+j)*64))[i]);
+    for(;j < LANES;j++)
+      for(i=0;i < 16;i++)
+        X[i][j]=0;
+
+    aa=bb=cc=dd=ee=(VEC){};
+    aa += 0x67452301;
+    bb += 0xefcdab89;
+    cc += 0x98badcfe;
+    dd += 0x10325476;
+    ee += 0xc3d2e1f0;
+    aaa=aa, bbb=bb, ccc=cc, ddd=dd, eee=ee;
+
+    VGROUP( 0, F1, K1, F5, KK1);
+    VGROUP(16, F2, K2, F4, KK2);
+    VGROUP(32, F3, K3, F3, KK3);
+    VGROUP(48, F4, K4, F2, KK4);
+    VGROUP(64, F5, K5, F1, KK5);
+
+    /* Combine results */
+    ddd += cc + 0xefcdab89;
+    temp = 0x98badcfe + dd + eee;
+    eee = 0x10325476 + ee + aaa;
+    aaa = 0xc3d2e1f0 + aa + bbb;
+    bbb = 0x67452301 + bb + ccc;
+
+    /* Save output */
+    for(j=0;j < lanes;j++) {
+      out=(u32 *)(output+(k+j)*20);
+      out[0]=le32(ddd[j]);
+      out[1]=le32(temp[j]);
+      out[2]=le32(eee[j]);
+      out[3]=le32(aaa[j]);
+      out[4]=le32(bbb[j]);
+    }
+  }
+}
+
+#undef VROL
+#undef VROUND
+#undef VGROUP
+#undef VEC
+#undef LANES
+#undef KERNEL
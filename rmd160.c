@@ -16,15 +16,33 @@
 
 #include "externs.h"
 
-static u32 digest[5];
+static void rmd160_blocks_x1(char *output, const char *input, int n);
+static void rmd160_blocks_x4(char *output, const char *input, int n);
+#ifdef __x86_64__
+static void rmd160_blocks_x8(char *output, const char *input, int n);
+static void rmd160_blocks_x16(char *output, const char *input, int n);
+#endif
 
-void rmd160_init()
+static void (*rmd160_blocks_func)(char *output, const char *input, int n)=
+  rmd160_blocks_x1;
+
+const struct hash_kernel rmd160_kernels[]={
+  {"generic",    1, 0},
+  {"vec4",       4, 0},
+#ifdef __x86_64__
+  {"avx2-x8",    8, CPU_AVX2},
+  {"avx512-x16", 16, CPU_AVX512},
+#endif
+  {NULL}
+};
+
+void rmd160_init(u32 state[5])
 {
-  digest[0]=0x67452301;
-  digest[1]=0xefcdab89;
-  digest[2]=0x98badcfe;
-  digest[3]=0x10325476;
-  digest[4]=0xc3d2e1f0;
+  state[0]=0x67452301;
+  state[1]=0xefcdab89;
+  state[2]=0x98badcfe;
+  state[3]=0x10325476;
+  state[4]=0xc3d2e1f0;
 }
 
 #define K1  0x00000000
@@ -257,24 +275,118 @@ static void rmd160_transform(u32 state[5], const u32 in[16])
   state[0] = ddd;
 }
 
-void rmd160_process(const char input_block[64])
+void rmd160_process(u32 state[5], const char input_block[64])
 {
-  rmd160_transform(digest, (const u32 *)input_block);
+  rmd160_transform(state, (const u32 *)input_block);
 }
 
-void rmd160_finish(char output[20])
+void rmd160_finish(const u32 state[5], char output[20])
 {
   u32 *out=(u32 *)output;
   int i;
 
   /* Save output */
   for(i=0;i < 5;i++)
-    out[i]=le32(digest[i]);
+    out[i]=le32(state[i]);
 }
 
 void rmd160_hash(char output[20], const char input[64])
 {
-  rmd160_init();
-  rmd160_process(input);
-  rmd160_finish(output);
+  u32 state[5];
+
+  rmd160_init(state);
+  rmd160_process(state, input);
+  rmd160_finish(state, output);
+}
+
+// Hash 'n' independent, already padded 64-byte blocks from 'input', storing
+// n 20-byte digests to 'output'.
+//
+void rmd160_blocks(char *output, const char *input, int n)
+{
+  rmd160_blocks_func(output, input, n);
+}
+
+static void rmd160_blocks_x1(char *output, const char *input, int n)
+{
+  int i;
+
+  for(i=0;i < n;i++)
+    rmd160_hash(output+i*20, input+i*64);
+}
+
+/* Message word order and rotate amounts for the left and right lanes */
+static const u8 rmd160_r[80]={
+   0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15,
+   7,  4, 13,  1, 10,  6, 15,  3, 12,  0,  9,  5,  2, 14, 11,  8,
+   3, 10, 14,  4,  9, 15,  8,  1,  2,  7,  0,  6, 13, 11,  5, 12,
+   1,  9, 11, 10,  0,  8, 12,  4, 13,  3,  7, 15, 14,  5,  6,  2,
+   4,  0,  5,  9,  7, 12,  2, 10, 14,  1,  3,  8, 11,  6, 15, 13,
+};
+
+static const u8 rmd160_rr[80]={
+   5, 14,  7,  0,  9,  2, 11,  4, 13,  6, 15,  8,  1, 10,  3, 12,
+   6, 11,  3,  7,  0, 13,  5, 10, 14, 15,  8, 12,  4,  9,  1,  2,
+  15,  5,  1,  3,  7, 14,  6,  9, 11,  8, 12,  2, 10,  0,  4, 13,
+   8,  6,  4,  1,  3, 11, 15,  0,  5, 12,  2, 13,  9,  7, 10, 14,
+  12, 15, 10,  4,  1,  5,  8,  7,  6,  2, 13, 14,  0,  3,  9, 11,
+};
+
+static const u8 rmd160_s[80]={
+  11, 14, 15, 12,  5,  8,  7,  9, 11, 13, 14, 15,  6,  7,  9,  8,
+   7,  6,  8, 13, 11,  9,  7, 15,  7, 12, 15,  9, 11,  7, 13, 12,
+  11, 13,  6,  7, 14,  9, 13, 15, 14,  8, 13,  6,  5, 12,  7,  5,
+  11, 12, 14, 15, 14, 15,  9,  8,  9, 14,  5,  6,  8,  6,  5, 12,
+   9, 15,  5, 11,  6,  8, 13, 12,  5, 12, 13, 14, 11,  8,  5,  6,
+};
+
+static const u8 rmd160_ss[80]={
+   8,  9,  9, 11, 13, 15, 15,  5,  7,  7,  8, 11, 14, 14, 12,  6,
+   9, 13, 15,  7, 12,  8,  9, 11,  7,  7, 12,  7,  6, 15, 13, 11,
+   9,  7, 15, 11,  8,  6,  6, 14, 12, 13,  5, 14, 13, 13,  7,  5,
+  15,  5,  8, 11, 14, 14,  6, 14,  6,  9, 12,  9, 12,  5, 15,  8,
+   8,  5, 12,  9, 12,  5, 14,  6,  8, 13,  6,  5, 15, 13, 11, 11,
+};
+
+/* Generic 4-lane kernel (SSE2 on x86_64, NEON on arm64) */
+typedef u32 v4u32 __attribute__((vector_size(16)));
+#define VEC v4u32
+#define LANES 4
+#define KERNEL rmd160_blocks_x4
+#include "rmd160-multi.h"
+
+#ifdef __x86_64__
+
+#pragma GCC push_options
+#pragma GCC target("avx2")
+typedef u32 v8u32 __attribute__((vector_size(32)));
+#define VEC v8u32
+#define LANES 8
+#define KERNEL rmd160_blocks_x8
+#include "rmd160-multi.h"
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+typedef u32 v16u32 __attribute__((vector_size(64)));
+#define VEC v16u32
+#define LANES 16
+#define KERNEL rmd160_blocks_x16
+#include "rmd160-multi.h"
+#pragma GCC pop_options
+
+#endif
+
+// Select kernel number 'k' from rmd160_kernels[] for rmd160_blocks().
+//
+void rmd160_use_kernel(int k)
+{
+  static void (*const blocks[])(char *, const char *, int)={
+    rmd160_blocks_x1, rmd160_blocks_x4,
+#ifdef __x86_64__
+    rmd160_blocks_x8, rmd160_blocks_x16,
+#endif
+  };
+
+  rmd160_blocks_func=blocks[k];
 }
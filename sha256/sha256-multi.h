@@ -0,0 +1,93 @@
+/* sha256-multi.h - Multi-buffer SHA-256 kernel template */
+
+// This file is included by sha256.c once for each vector width. Before
+// inclusion, define:
+//
+//   VEC     A GCC vector type of 32-bit unsigned integers
+//   LANES   Number of elements in VEC
+//   KERNEL  Name of the function to generate
+//
+// The generated function hashes 'n' independent, already padded 64-byte
+// blocks, LANES at a time, with one message per vector lane.
+
+#define VROR(x,n) (((x) >> (n)) | ((x) << (32-(n))))
+
+#define VS0(x) (VROR(x, 7) ^ VROR(x,18) ^ ((x) >> 3))
+#define VS1(x) (VROR(x,17) ^ VROR(x,19) ^ ((x) >> 10))
+#define VS2(x) (VROR(x, 2) ^ VROR(x,13) ^ VROR(x,22))
+#define VS3(x) (VROR(x, 6) ^ VROR(x,11) ^ VROR(x,25))
+
+#define VF0(x,y,z) (((x) & (y)) | ((z) & ((x) | (y))))
+#define VF1(x,y,z) ((z) ^ ((x) & ((y) ^ (z))))
+
+static void KERNEL(char *output, const char *input, int n, const u32 *state)
+{
+  VEC W[16], A, B, C, D, E, F, G, H, temp1, temp2;
+  u32 *out;
+  int i, j, k, lanes;
+
+  for(k=0;k < n;k += LANES) {
+    lanes=min(n-k, LANES);
+
+    /* Transpose input blocks into vectors of big-endian words */
+    for(j=0;j < lanes;j++)
+      for(i=0;i < 16;i++)
+        W[i][j]=be32(((const u32 *)(input+(k+j)*64))[i]);
+    for(;j < LANES;j++)
+      for(i=0;i < 16;i++)
+        W[i][j]=0;
+
+    A=B=C=D=E=F=G=H=(VEC){};
+    A += state[0];
+    B += state[1];
+    C += state[2];
+    D += state[3];
+    E += state[4];
+    F += state[5];
+    G += state[6];
+    H += state[7];
+
+    for(i=0;i < 64;i++) {
+      if(i >= 16)
+        W[i&15] += VS1(W[(i+14)&15]) + W[(i+9)&15] + VS0(W[(i+1)&15]);
+
+      temp1 = H + VS3(E) + VF1(E,F,G) + sha256_K[i] + W[i&15];
+      temp2 = VS2(A) + VF0(A,B,C);
+      H = G; G = F; F = E; E = D + temp1;
+      D = C; C = B; B = A; A = temp1 + temp2;
+    }
+
+    A += state[0];
+    B += state[1];
+    C += state[2];
+    D += state[3];
+    E += state[4];
+    F += state[5];
+    G += state[6];
+    H += state[7];
+
+    /* Save output */
+    for(j=0;j < lanes;j++) {
+      out=(u32 *)(output+(k+j)*32);
+      out[0]=be32(A[j]);
+      out[1]=be32(B[j]);
+      out[2]=be32(C[j]);
+      out[3]=be32(D[j]);
+      out[4]=be32(E[j]);
+      out[5]=be32(F[j]);
+      out[6]=be32(G[j]);
+      out[7]=be32(H[j]);
+    }
+  }
+}
+
+#undef VROR
+#undef VS0
+#undef VS1
+#undef VS2
+#undef VS3
+#undef VF0
+#undef VF1
+#undef VEC
+#undef LANES
+#undef KERNEL
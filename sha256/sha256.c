@@ -9,21 +9,60 @@ extern void sha256_transform_avx(u32 *digest, const char *data, u64 nblk);
 extern void sha256_transform_rorx(u32 *digest, const char *data, u64 nblk);
 extern void sha256_ni_transform(u32 *digest, const char *data, u64 nblk);
 
+static void sha256_blocks_x1(char *output, const char *input, int n,
+                             const u32 *state);
+static void sha256_blocks_x4(char *output, const char *input, int n,
+                             const u32 *state);
+#ifdef __x86_64__
+static void sha256_blocks_x8(char *output, const char *input, int n,
+                             const u32 *state);
+static void sha256_blocks_x16(char *output, const char *input, int n,
+                              const u32 *state);
+#endif
+
 static void (*sha256_transform_func)(u32 *digest, const char *data, u64 nblk)=
   sha256_transform;
 
-static u32 digest[8];
+static void (*sha256_blocks_func)(char *output, const char *input, int n,
+                                  const u32 *state)=sha256_blocks_x1;
+
+/* Kernel list; entries with lanes=1 are also used for sha256_process() */
+const struct hash_kernel sha256_kernels[]={
+  {"generic",    1, 0},
+  {"vec4",       4, 0},
+#ifdef __x86_64__
+  {"ssse3",      1, CPU_SSSE3},
+  {"avx",        1, CPU_AVX},
+  {"avx2",       1, CPU_AVX2},
+  {"sha-ni",     1, CPU_SHA},
+  {"avx2-x8",    8, CPU_AVX2},
+  {"avx512-x16", 16, CPU_AVX512},
+#endif
+  {NULL}
+};
+
+static const u32 sha256_iv[8]={
+  0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+  0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+};
+
+static const u32 sha256_K[64]={
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+  0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+  0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+  0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+  0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+  0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+  0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+  0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+  0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
 
-void sha256_init()
+void sha256_init(u32 state[8])
 {
-  digest[0]=0x6a09e667;
-  digest[1]=0xbb67ae85;
-  digest[2]=0x3c6ef372;
-  digest[3]=0xa54ff53a;
-  digest[4]=0x510e527f;
-  digest[5]=0x9b05688c;
-  digest[6]=0x1f83d9ab;
-  digest[7]=0x5be0cd19;
+  memcpy(state, sha256_iv, 32);
 }
 
 // Process input in chunks of 64 bytes. (1 block only; nblk is ignored)
@@ -145,69 +184,103 @@ static void sha256_transform(u32 *digest, const char *data, u64 nblk)
   digest[7] += H;
 }
 
-void sha256_process(const char input_block[64])
+void sha256_process(u32 state[8], const char input_block[64])
 {
-  sha256_transform_func(digest, input_block, 1);
+  sha256_transform_func(state, input_block, 1);
 };
 
-void sha256_finish(char output[32])
+void sha256_finish(const u32 state[8], char output[32])
 {
   unsigned int *out=(unsigned int *)output;
   int i;
 
   /* Save output */
   for(i=0;i < 8;i++)
-    out[i]=be32(digest[i]);
+    out[i]=be32(state[i]);
 }
 
 void sha256_hash(char output[32], const char input[64])
 {
-  sha256_init();
-  sha256_process(input);
-  sha256_finish(output);
-}
+  u32 state[8];
 
-#define cpuid(level, arg, a, b, c, d) \
-  asm("cpuid" \
-      : "=a" (a), "=b" (b), "=c" (c), "=d" (d) \
-      : "0" (level), "2" (arg))
+  sha256_init(state);
+  sha256_process(state, input);
+  sha256_finish(state, output);
+}
 
-// Auto-detect the fastest SHA-256 function to use based on CPUID flags.
+// Hash 'n' independent, already padded 64-byte blocks from 'input', storing
+// n 32-byte digests to 'output'. Each hash starts from 'state', or from the
+// standard initial value if 'state' is NULL.
 //
-void sha256_register(bool verbose)
+void sha256_blocks(char *output, const char *input, int n, const u32 state[8])
 {
-#ifdef __x86_64__
-  u32 eax, ebx, ecx, edx;
-
-  cpuid(0, 0, eax, ebx, ecx, edx);
-  if(eax >= 7) {
-    cpuid(7, 0, eax, ebx, ecx, edx);
-    if(ebx & (1 << 29)) {
-      if(verbose)
-        printf("Intel SHA-NI enabled.\n");
-      sha256_transform_func=sha256_ni_transform;
-      return;
-    }
-    if((ebx & (1 << 8)) && (ebx & (1 << 5))) {
-      if(verbose)
-        printf("Intel AVX2 enabled.\n");
-      sha256_transform_func=sha256_transform_rorx;
-      return;
-    }
-  }
+  sha256_blocks_func(output, input, n, state ?: sha256_iv);
+}
 
-  cpuid(1, 0, eax, ebx, ecx, edx);
-  if(ecx & (1 << 28)) {
-    if(verbose)
-      printf("Intel AVX enabled.\n");
-    sha256_transform_func=sha256_transform_avx;
-    return;
-  }
-  if(ecx & (1 << 9)) {
-    if(verbose)
-      printf("Intel SSSE3 enabled.\n");
-    sha256_transform_func=sha256_transform_ssse3;
-    return;
+static void sha256_blocks_x1(char *output, const char *input, int n,
+                             const u32 *state)
+{
+  u32 digest[8];
+  int i;
+
+  for(i=0;i < n;i++) {
+    memcpy(digest, state, 32);
+    sha256_transform_func(digest, input+i*64, 1);
+    sha256_finish(digest, output+i*32);
   }
+}
+
+/* Generic 4-lane kernel (SSE2 on x86_64, NEON on arm64) */
+typedef u32 v4u32 __attribute__((vector_size(16)));
+#define VEC v4u32
+#define LANES 4
+#define KERNEL sha256_blocks_x4
+#include "sha256-multi.h"
+
+#ifdef __x86_64__
+
+#pragma GCC push_options
+#pragma GCC target("avx2")
+typedef u32 v8u32 __attribute__((vector_size(32)));
+#define VEC v8u32
+#define LANES 8
+#define KERNEL sha256_blocks_x8
+#include "sha256-multi.h"
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+typedef u32 v16u32 __attribute__((vector_size(64)));
+#define VEC v16u32
+#define LANES 16
+#define KERNEL sha256_blocks_x16
+#include "sha256-multi.h"
+#pragma GCC pop_options
+
 #endif
+
+// Select kernel number 'k' from sha256_kernels[]. Single-lane kernels are
+// used for both sha256_process() and sha256_blocks(); multi-lane kernels only
+// replace sha256_blocks().
+//
+void sha256_use_kernel(int k)
+{
+  static void (*const transform[])(u32 *, const char *, u64)={
+    sha256_transform, NULL,
+#ifdef __x86_64__
+    sha256_transform_ssse3, sha256_transform_avx, sha256_transform_rorx,
+    sha256_ni_transform, NULL, NULL,
+#endif
+  };
+  static void (*const blocks[])(char *, const char *, int, const u32 *)={
+    sha256_blocks_x1, sha256_blocks_x4,
+#ifdef __x86_64__
+    sha256_blocks_x1, sha256_blocks_x1, sha256_blocks_x1, sha256_blocks_x1,
+    sha256_blocks_x8, sha256_blocks_x16,
+#endif
+  };
+
+  if(transform[k])
+    sha256_transform_func=transform[k];
+  sha256_blocks_func=blocks[k];
 }
@@ -0,0 +1,107 @@
+/* vanity.h - Super Vanitygen library interface (libvanity) */
+
+// A job is set up with options and patterns (prefixes, suffixes or words),
+// then started on a number of forked worker processes. The calling process
+// manages the search: it calls vanity_poll() in a loop, which verifies the
+// keys that workers send up and delivers each result to a callback, or queues
+// it to be read with vanity_next_result().
+//
+// The search state is global, so a process runs a single job. A daemon job
+// (VANITY_DAEMON) keeps its workers running and serves the jobs of other
+// processes, sending them their results; it never finishes. Starting a job
+// ignores SIGPIPE and SIGCHLD, as finished workers are never waited for. A
+// job with VANITY_TARGET and a VANITY_LIST file catches SIGHUP, and adds the
+// new prefixes of the file when vanity_poll() next runs. Errors, including
+// running out of memory, are returned to the caller and reported on standard
+// error, as are the messages of a job that isn't quiet.
+
+#ifndef VANITY_H
+#define VANITY_H
+
+/* Options for vanity_set_option(), named after the command-line flags */
+#define VANITY_REBENCH     'B'  // Re-run the hash kernel benchmark
+#define VANITY_CHECKPOINT  'C'  // Seeded search, checkpointed to file 'arg'
+#define VANITY_DAEMON      'D'  // Serve jobs from clients on unix socket 'arg'
+#define VANITY_BSGS_MEMORY 'M'  // Baby-step table memory limit in MB
+#define VANITY_ORDERS      'P'  // Split-key orders from file 'arg'
+#define VANITY_RANGE       'R'  // Scan private keys "start:end" (hex)
+#define VANITY_COORDINATE  'S'  // Coordinate nodes on TCP "[host:]port"
+#define VANITY_BSGS_TABLE  'T'  // Baby-step table file
+#define VANITY_BSGS        'b'  // Find the private key of public key 'arg'
+#define VANITY_COUNT       'c'  // Stop after 'arg' results
+#define VANITY_LIST        'f'  // Read patterns from file 'arg'
+#define VANITY_GENERATE    'g'  // Output every key, as "csv" or "bin"
+#define VANITY_ANYCASE     'i'  // Case-insensitive matches
+#define VANITY_KEEP_GOING  'k'  // Never stop looking for results
+#define VANITY_MULTISIG    'm'  // 2-of-3 multisig cosigners "hex1,hex2"
+#define VANITY_TARGET      'n'  // Retire each prefix after 'arg' results
+#define VANITY_OUTPUT      'o'  // Write generated keys to file 'arg'
+#define VANITY_SPLIT_KEY   'p'  // Split-key search from public key 'arg'
+#define VANITY_QUIET       'q'  // No informational messages
+#define VANITY_NO_REKEY    'r'  // Don't rekey after a match
+#define VANITY_SUFFIX      's'  // Match suffixes instead of prefixes
+#define VANITY_VERBOSE     'v'  // List the compiled patterns
+#define VANITY_WORDS       'w'  // Match words anywhere in the address
+
+/* Default of VANITY_BSGS_MEMORY */
+#define VANITY_BSGS_DEFAULT 1024
+
+/* Return value of vanity_start() when the patterns and options given don't
+   make up a search */
+#define VANITY_USAGE (-1)
+
+/* Most addresses reported for one key, one per matching network */
+#define VANITY_MAX_ADDRESSES 8
+
+/* A key found by the search */
+struct vanity_result {
+  int found;                      // Number of this result, from 1
+  int last;                       // The job is finished after this result
+  int partial;                    // 'privkey' is a split-key partial key
+  unsigned char privkey[32];      // Private key, big-endian
+  unsigned char hash[20];         // Hashed public key, or Ethereum address
+  int num_addresses;
+  struct {
+    char key[96];                 // WIF, or hex for Ethereum and split keys
+    char address[112];
+    const char *network;          // Name, or NULL when only Bitcoin is used
+  } addresses[VANITY_MAX_ADDRESSES];
+  const char *customer_key;       // Public key of the -P order, or NULL
+  const char *word;               // Word found in the address, or NULL
+  char redeem_script[212];        // Multisig redeem script in hex, or ""
+};
+
+/* Progress of a job */
+struct vanity_stats {
+  unsigned long long keys;        // Keys since the last result, or all keys
+                                  // of a range scan (giant steps with -b)
+  unsigned long long rate;        // Keys per second, over the last 8 seconds
+  unsigned long long range_keys;  // Keys in the -R range, or 0
+  double difficulty;              // Expected keys per result
+  int found;                      // Results found
+  int wanted;                     // Results wanted, or 0 with -k
+  int finished;                   // No more results will come
+  int stopped;                    // Stopped by vanity_stop() or a coordinator
+};
+
+typedef void (*vanity_callback)(const struct vanity_result *result,
+                                void *arg);
+
+struct vanity_job;
+
+extern struct vanity_job *vanity_create(void);
+extern int  vanity_set_option(struct vanity_job *job, int option,
+                              const char *arg);
+extern int  vanity_add_pattern(struct vanity_job *job, const char *pattern);
+extern void vanity_set_callback(struct vanity_job *job,
+                                vanity_callback callback, void *arg);
+extern int  vanity_start(struct vanity_job *job, int threads);
+extern int  vanity_poll(struct vanity_job *job, struct vanity_stats *stats);
+extern void vanity_get_stats(struct vanity_job *job,
+                             struct vanity_stats *stats);
+extern const struct vanity_result *vanity_next_result(struct vanity_job *job);
+extern void vanity_stop(struct vanity_job *job);
+extern void vanity_free(struct vanity_job *job);
+extern int  vanity_join(const char *addr, int *argc, char ***argv);
+
+#endif